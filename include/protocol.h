@@ -1,8 +1,15 @@
 #ifndef PROTOCOL_H
 #define PROTOCOL_H
 
+#include <stdint.h>
+#include <stddef.h>
+
 #define SOCKET_PATH "/tmp/taskmaster.sock"
+#define NOTIFY_SOCKET_PATH "/tmp/taskmaster.notify"
 #define MAX_MSG_LEN 8192
+#define STATUS_BOARD_NAME "/taskmaster.status" // shm_open name
+#define STATUS_BOARD_MAGIC 0x544d5342
+#define STATUS_BOARD_VERSION 1
 
 typedef enum {
     CMD_STATUS,
@@ -10,17 +17,90 @@ typedef enum {
     CMD_STOP,
     CMD_RESTART,
     CMD_RELOAD,
-    CMD_SHUTDOWN
+    CMD_SHUTDOWN,
+    CMD_HISTORY,
+    CMD_SCALE,
+    CMD_STATS,
+    CMD_QUERY
 } CommandType;
 
+#define REQ_BINARY 0x1 // answer a query with QueryEntry records instead of JSON
+
+// Requests and responses carry an id so a client can pipeline several
+// commands over one connection and match the replies. A reply larger than
+// one response is split into frames with the same id; every frame but the
+// last has `more` set. On the wire a frame is the header followed by
+// `length` bytes of response: the text without its terminator, or binary
+// records. The daemon fills in `length` for text replies.
 typedef struct {
+    uint32_t id;
     CommandType type;
+    uint32_t flags;
     char payload[MAX_NAME_LEN];
 } TMRequest;
 
 typedef struct {
-    char response[MAX_MSG_LEN];
+    uint32_t id;
     bool success;
+    bool more;
+    uint32_t length;
+    char response[MAX_MSG_LEN];
 } TMResponse;
 
+#define TM_RESPONSE_HEADER offsetof(TMResponse, response)
+
+// Binary query record. The JSON encoding has the same fields.
+#define QUERY_EXIT_NONE   0
+#define QUERY_EXIT_CODE   1
+#define QUERY_EXIT_SIGNAL 2
+
+typedef struct {
+    char name[MAX_NAME_LEN];
+    char group[MAX_NAME_LEN];
+    int32_t state_code;
+    int32_t index;
+    int32_t pid;
+    int32_t restart_count;
+    int64_t uptime;         // seconds alive, 0 without a live instance
+    int64_t start_time;
+    int64_t stop_time;
+    int32_t last_exit_kind; // QUERY_EXIT_*
+    int32_t last_exit;      // exit code or signal number
+    uint32_t flags;         // BOARD_* flags
+    uint32_t expected;      // the last exit code was listed in exitcodes
+} QueryEntry;
+
+// Shared-memory status board. The daemon is the only writer and publishes
+// the process table under a seqlock: seq is odd while entries are being
+// rewritten, so a reader copies the entries and retries unless seq was even
+// and unchanged around the copy. The segment grows on reload; readers remap
+// when capacity exceeds what they mapped.
+#define BOARD_PARKED   0x1 // autoscaling slot outside the active set
+#define BOARD_PENDING  0x2 // waiting on dependencies
+#define BOARD_DEFERRED 0x4 // start held back by resource pressure
+
+typedef struct {
+    char name[MAX_NAME_LEN];
+    char state[16];
+    int32_t state_code;
+    int32_t index;
+    int32_t pid;
+    int32_t restart_count;
+    int64_t start_time;
+    int64_t stop_time;
+    uint32_t flags;
+    uint32_t reserved;
+} BoardEntry;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seq;
+    uint32_t num_entries;
+    uint32_t capacity;
+    int32_t daemon_pid;
+    int64_t heartbeat; // wall time of the last publish, updated every loop
+    BoardEntry entries[];
+} StatusBoard;
+
 #endif
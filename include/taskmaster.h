@@ -1,11 +1,13 @@
 #ifndef TASKMASTER_H
 #define TASKMASTER_H
 
+#include <sched.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <signal.h>
 #include <time.h>
 #include <stdbool.h>
+#include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <pwd.h>
@@ -16,6 +18,9 @@
 #define MAX_EXIT_CODES 32
 #define MAX_PROCS 100
 #define MAX_NAME_LEN 64
+#define MAX_CLIENTS 32
+#define MAX_DEPS 16
+#define HISTORY_LEN 16
 #define DEFAULT_CONFIG_DIR "/etc/taskmaster"
 
 #include "protocol.h"
@@ -26,6 +31,32 @@ typedef enum {
     RESTART_UNEXPECTED
 } RestartPolicy;
 
+typedef enum {
+    AFFINITY_NONE,
+    AFFINITY_LIST,       // explicit cpu list shared by every instance
+    AFFINITY_PER_INDEX,  // one allowed cpu per proc_index
+    AFFINITY_NUMA_SPREAD // instances round-robin across NUMA nodes
+} AffinityMode;
+
+typedef enum {
+    IOPRIO_CLASS_NONE,
+    IOPRIO_CLASS_RT,
+    IOPRIO_CLASS_BE,
+    IOPRIO_CLASS_IDLE
+} IoprioClass;
+
+typedef enum {
+    SCALE_MANUAL,       // only the scale command changes the instance count
+    SCALE_CPU,          // average cpu % of the live instances
+    SCALE_QUEUE_FILE,   // queue depth read from a file, per active instance
+    SCALE_QUEUE_SOCKET  // queue depth read from a unix socket, per active instance
+} ScaleSignal;
+
+typedef enum {
+    OUTPUT_DROP,   // over-budget output replaced by a suppressed marker
+    OUTPUT_SAMPLE  // same, but every Nth suppressed line is kept
+} OutputOverflow;
+
 typedef enum {
     STATE_STOPPED,
     STATE_STARTING,
@@ -35,10 +66,37 @@ typedef enum {
     STATE_STOPPING
 } ProcessState;
 
+typedef enum {
+    EVENT_START,
+    EVENT_READY,
+    EVENT_EXIT,
+    EVENT_SIGNAL,
+    EVENT_RESTART,
+    EVENT_STOP,
+    EVENT_FATAL
+} EventType;
+
+typedef struct {
+    time_t time;
+    EventType type;
+    int value;       // pid, exit code, signal number or restart attempt
+    bool expected;   // exit code listed in exitcodes
+    int runtime_ms;  // how long the instance ran, for exit and signal events
+} ProcessEvent;
+
 typedef struct {
     char name[MAX_NAME_LEN];
+    char group[MAX_NAME_LEN]; // optional, for filtered queries
     char cmd[MAX_CMD_LEN];
     int numprocs;
+    int numprocs_min;
+    int numprocs_max; // process slots reserved for the program
+    ScaleSignal scale_signal;
+    char scale_source[MAX_CMD_LEN];
+    double scale_up;
+    double scale_down;
+    int scale_interval;
+    int scale_cooldown;
     mode_t umask;
     char workingdir[MAX_CMD_LEN];
     bool autostart;
@@ -54,8 +112,69 @@ typedef struct {
     char *env[MAX_ENV_VARS];
     int num_env;
     char user[MAX_NAME_LEN]; // New field for privilege de-escalation
+    bool ready_notify; // RUNNING on READY=1 instead of after starttime
+    AffinityMode affinity_mode;
+    char cpu_affinity[MAX_NAME_LEN];
+    bool has_nice;
+    int nice;
+    int sched_policy; // -1 keeps the daemon's policy
+    int sched_priority;
+    int ioprio_class;
+    int ioprio_level;
+    int priority; // lower is more important; decides admission under pressure
+    // Output budget; with either rate set the daemon captures stdout_path
+    // and stderr_path output through pipes and enforces it
+    double output_bytes_per_sec;
+    double output_lines_per_sec;
+    int output_burst; // seconds of budget a bucket can hold
+    OutputOverflow output_overflow;
+    int output_sample_every;
+    char depends_on[MAX_DEPS][MAX_NAME_LEN];
+    int num_depends;
+    // Resolved by resolve_dependencies(), not part of the parsed config
+    int dep_index[MAX_DEPS];
+    int num_dep_index;
+    int wave;
+    // Set by rebuild_program_index()
+    int proc_base;     // first slot in tm->processes
+    int next_in_group; // next program of the same group, -1 at the end
+    // Autoscaling state, carried across reloads of an unchanged program
+    int active_procs;
+    time_t last_scale;
+    time_t last_sample;
+    double last_load;
+    unsigned long long cpu_ticks;
+    uint64_t cpu_sample_us;
+    unsigned long long deferred_starts; // starts held back by resource pressure
+    // Output token buckets, shared by every instance and stream
+    double byte_tokens;
+    double line_tokens;
+    uint64_t output_refill_us;
+    unsigned long long suppressed_bytes;
+    unsigned long long suppressed_lines;
+    unsigned long long sampled_lines;
+    // Stop latency during the shutdown sequence
+    int stop_count;
+    int stop_killed;
+    uint64_t stop_total_us;
+    uint64_t stop_max_us;
 } ProgramConfig;
 
+// A child stream the daemon reads to enforce the output budget
+typedef struct {
+    bool captured;
+    int pipe_fd;
+    int file_fd;
+    bool mid_line;  // last chunk did not end with a newline
+    bool dropping;  // the current line is being suppressed
+    bool sampling;  // the current line is kept as a sample
+    bool cut;       // the file ends in a line cut short by the byte budget
+    unsigned long long pending_bytes; // suppressed since the last marker
+    unsigned long long pending_lines;
+    unsigned long long skipped; // suppressed lines since the last sample
+    uint64_t marker_us; // start of the pending suppressed run
+} OutputStream;
+
 typedef struct {
     pid_t pid;
     ProcessState state;
@@ -64,16 +183,123 @@ typedef struct {
     int restart_count;
     ProgramConfig *config;
     int proc_index;
+    uint64_t spawn_us;
+    bool ready_timed_out;
+    char notify_status[MAX_NAME_LEN]; // last STATUS= sent over NOTIFY_SOCKET
+    bool start_pending; // waiting for dependencies before start_process
+    bool stop_pending;  // waiting for dependents to exit before stop_process
+    bool deferred;      // start held back by resource pressure
+    uint64_t stop_us;          // when the stopsignal was sent
+    uint64_t stop_deadline_us; // SIGKILL after this, from stoptime
+    bool kill_sent;
+    uint64_t restart_us; // last restart by the restart policy
+    bool retired;        // dropped by a reload, kept until reaped
+    int retired_slot;    // index in Taskmaster.retired while retired
+    OutputStream output[2]; // stdout, stderr
+    // Fixed-size ring of recent lifecycle events, oldest overwritten first
+    ProcessEvent history[HISTORY_LEN];
+    int history_next;
+    int history_count;
 } Process;
 
+// Pluggable process operations. The real backend forks actual children;
+// the simulated one models them in memory for supervisor-scale testing.
+typedef struct {
+    const char *name;
+    pid_t (*spawn)(Process *proc);   // returns the new pid, or -1
+    int (*signal)(pid_t pid, int sig);
+    pid_t (*reap)(int *status);      // non-blocking, 0 when nothing exited
+    uint64_t (*next_exit_us)(void);  // earliest pending exit, 0 if none; NULL when SIGCHLD wakes the daemon
+} ProcessBackend;
+
+typedef struct {
+    unsigned long long count;
+    unsigned long long total_us;
+    unsigned long long max_us;
+} Timing;
+
+// Cost counters reported by the stats command
+typedef struct {
+    unsigned long long reaped;
+    Timing reap;       // per update_processes pass
+    Timing scheduler;  // promotions, dependency scheduling, convergence
+    Timing status;     // formatting a status reply
+    Timing reload;
+    Timing query;
+} DaemonStats;
+
+typedef enum {
+    PRESSURE_MEMORY,
+    PRESSURE_CPU,
+    PRESSURE_RESOURCES
+} PressureResource;
+
+// Top-level `pressure:` section of the config
+typedef struct {
+    double threshold[PRESSURE_RESOURCES]; // "some" stall percent, 0 disables
+    char source[PRESSURE_RESOURCES][MAX_CMD_LEN];
+    int window_ms;          // PSI trigger window
+    int critical_priority;  // programs at or below it are never deferred
+    int admit_rate;         // non-critical starts per second under pressure
+} PressureConfig;
+
+typedef struct {
+    PressureConfig cfg;
+    int fds[PRESSURE_RESOURCES];
+    bool trigger[PRESSURE_RESOURCES]; // kernel trigger armed, else polled
+    double level[PRESSURE_RESOURCES]; // "some" stall percent at the last sample
+    long long last_total[PRESSURE_RESOURCES];
+    uint64_t sample_us[PRESSURE_RESOURCES];
+    bool active;
+    uint64_t active_since_us;
+    unsigned long long deferred; // deferrals since the daemon started
+    time_t admit_second;
+    int admitted;
+} PressureState;
+
+// A controller connection. Requests are assembled from partial reads and
+// replies are queued until the socket is writable, so a stalled client can
+// never block the daemon. When the table is full the least recently active
+// connection is closed to make room.
+#define CLIENT_QUEUE_MAX (64 * sizeof(TMResponse)) // stop reading requests above this
+
+typedef struct {
+    int fd;
+    char in[sizeof(TMRequest)];
+    size_t in_len;
+    char *out;
+    size_t out_len;  // bytes queued
+    size_t out_sent; // bytes of out already written
+    size_t out_cap;
+    uint64_t active_us; // last request or reply progress, for eviction
+} ClientConn;
+
 typedef struct {
     ProgramConfig *configs;
     int num_configs;
     Process *processes;
     int num_processes;
+    Process **retired; // instances dropped by a reload that are still alive
+    int num_retired;
+    int retired_cap;
     char *log_file;
     bool running;
     int server_fd;
+    int notify_fd;
+    ClientConn clients[MAX_CLIENTS];
+    int num_clients;
+    bool converging;
+    uint64_t converge_start_us;
+    DaemonStats stats;
+    PressureState pressure;
+    StatusBoard *board;
+    size_t board_size;
+    BoardEntry *board_shadow; // last published entries
+    uint64_t next_deadline_us; // earliest pending stoptime escalation, 0 if none
+    bool shutting_down;
+    uint64_t shutdown_start_us;
+    int shutdown_client; // connection waiting for the shutdown report, -1 if none
+    uint32_t shutdown_req_id;
 } Taskmaster;
 
 // Shared Core Logic
@@ -81,12 +307,74 @@ void log_event(const char *format, ...);
 void update_processes(Taskmaster *tm);
 void start_process(Process *proc);
 void stop_process(Process *proc);
+void mark_ready(Process *proc, uint64_t recv_latency_us);
+Process *find_process_by_pid(Taskmaster *tm, pid_t pid);
+void schedule_start(Process *proc);
+void schedule_stop(Process *proc);
+void begin_convergence(Taskmaster *tm);
+int begin_shutdown(Taskmaster *tm);
+bool shutdown_complete(Taskmaster *tm, char *report, size_t len);
+uint64_t monotonic_us(void);
+void record_timing(Timing *t, uint64_t us);
+void rebuild_pid_index(Taskmaster *tm);
+Process *retire_process(Taskmaster *tm, const Process *proc, ProgramConfig **config_copy);
+void set_process_backend(const ProcessBackend *backend);
+const ProcessBackend *get_process_backend(void);
+extern const ProcessBackend real_backend;
+extern const ProcessBackend sim_backend;
+bool configure_simulation(const char *spec);
 void parse_config(const char *path, Taskmaster *tm);
 void parse_config_dir(const char *path, Taskmaster *tm);
 void reload_config(Taskmaster *tm, const char *config_path);
+bool resolve_dependencies(Taskmaster *tm);
+
+// Autoscaling
+int scale_program(Taskmaster *tm, ProgramConfig *cfg, int target, const char *reason);
+void update_autoscale(Taskmaster *tm);
+
+// Resource pressure admission
+void default_pressure_config(PressureConfig *cfg);
+void setup_pressure(Taskmaster *tm);
+void close_pressure(Taskmaster *tm);
+int pressure_fds(Taskmaster *tm, fd_set *fds, int max_fd);
+void handle_pressure_events(Taskmaster *tm, fd_set *fds);
+void update_pressure(Taskmaster *tm);
+bool pressure_defers(const Taskmaster *tm, const ProgramConfig *cfg);
+bool pressure_admit(Taskmaster *tm, const ProgramConfig *cfg, int best_waiting);
+void defer_start(Taskmaster *tm, Process *proc);
+void describe_pressure(const Taskmaster *tm, char *buf, size_t len);
+
+// Output rate limiting
+bool output_limited(const ProgramConfig *cfg);
+void prepare_output(Process *proc, int child_fds[2]);
+void attach_output(Process *proc, int child_fds[2], bool spawned);
+int output_fds(Taskmaster *tm, fd_set *fds, int max_fd);
+void handle_output(Taskmaster *tm, fd_set *fds);
+void flush_output_markers(Taskmaster *tm);
+void close_output(Process *proc);
+void describe_output_limits(const Taskmaster *tm, char *buf, size_t len);
+
+// Indexed status queries
+void rebuild_program_index(Taskmaster *tm);
+bool run_query(Taskmaster *tm, int client_fd, const TMRequest *req);
+
+// Shared-memory status board
+bool open_status_board(Taskmaster *tm);
+void publish_status_board(Taskmaster *tm);
+void close_status_board(Taskmaster *tm);
+
+// Process placement
+bool parse_cpu_list(const char *list, cpu_set_t *set);
+bool plan_placement(const Process *proc, cpu_set_t *set);
+void apply_placement(const ProgramConfig *cfg, const cpu_set_t *set);
+void describe_placement(const Process *proc, char *buf, size_t len);
+const char *sched_policy_to_string(int policy);
 const char *state_to_string(ProcessState state);
+const char *event_to_string(EventType type);
+void record_event(Process *proc, EventType type, int value, bool expected);
 
 // Daemon Specific
-void handle_client(Taskmaster *tm, int client_fd);
+bool handle_client(Taskmaster *tm, int client_fd, const TMRequest *req);
+bool queue_response(Taskmaster *tm, int client_fd, const TMResponse *res);
 
 #endif
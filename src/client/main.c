@@ -3,6 +3,29 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Maximum number of batch requests in flight before waiting for replies
+#define BATCH_WINDOW 64
+// Seqlock read attempts before giving up on a busy status board
+#define BOARD_READ_TRIES 1000
+
+typedef struct {
+    CommandType type;
+    char payload[MAX_NAME_LEN];
+    char line[MAX_CMD_LEN];
+    bool fast; // status read from the shared-memory board
+    uint32_t flags;
+} ClientCommand;
+
+static int g_fd = -1;
+static uint32_t g_next_id = 1;
+static bool g_json = false;
 
 static int connect_to_daemon() {
     int fd = socket(AF_UNIX, SOCK_STREAM, 0);
@@ -20,67 +43,409 @@ static int connect_to_daemon() {
     return fd;
 }
 
-static void send_command(CommandType type, const char *payload) {
-    int fd = connect_to_daemon();
-    if (fd < 0) {
+static void disconnect_from_daemon() {
+    if (g_fd >= 0) close(g_fd);
+    g_fd = -1;
+}
+
+// The connection is opened lazily and reused for the following commands of
+// a batch. The interactive shell drops it between prompts.
+static bool ensure_connected() {
+    if (g_fd >= 0) return true;
+    g_fd = connect_to_daemon();
+    if (g_fd < 0) {
         fprintf(stderr, "Error: Could not connect to daemon at %s\n", SOCKET_PATH);
-        return;
+        return false;
     }
+    return true;
+}
 
+static uint32_t send_request(const ClientCommand *cmd) {
     TMRequest req;
     memset(&req, 0, sizeof(req));
-    req.type = type;
-    if (payload) strncpy(req.payload, payload, sizeof(req.payload) - 1);
+    req.id = g_next_id++;
+    req.type = cmd->type;
+    req.flags = cmd->flags;
+    snprintf(req.payload, sizeof(req.payload), "%s", cmd->payload);
+
+    if (send(g_fd, &req, sizeof(req), MSG_NOSIGNAL) != (ssize_t)sizeof(req)) return 0;
+    return req.id;
+}
+
+static bool recv_response(TMResponse *res) {
+    memset(res, 0, sizeof(*res));
+    if (recv(g_fd, res, TM_RESPONSE_HEADER, MSG_WAITALL) != (ssize_t)TM_RESPONSE_HEADER) return false;
+    if (res->length > MAX_MSG_LEN) return false;
+    // The zeroed tail terminates text replies
+    if (res->length > 0 && recv(g_fd, res->response, res->length, MSG_WAITALL) != (ssize_t)res->length) return false;
+    return true;
+}
+
+static void print_json_string(const char *str) {
+    putchar('"');
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++) {
+        switch (*p) {
+            case '"': fputs("\\\"", stdout); break;
+            case '\\': fputs("\\\\", stdout); break;
+            case '\n': fputs("\\n", stdout); break;
+            case '\t': fputs("\\t", stdout); break;
+            default:
+                if (*p < 0x20) printf("\\u%04x", *p);
+                else putchar(*p);
+        }
+    }
+    putchar('"');
+}
+
+static void print_response(const ClientCommand *cmd, uint32_t id, const TMResponse *res) {
+    if (!g_json) {
+        if (res) printf("%s", res->response);
+        else fprintf(stderr, "Error: No response from daemon for '%s'\n", cmd->line);
+        return;
+    }
+    printf("{\"id\":%u,\"command\":", id);
+    print_json_string(cmd->line);
+    printf(",\"success\":%s,\"response\":", res && res->success ? "true" : "false");
+    print_json_string(res ? res->response : "no response from daemon");
+    printf("}\n");
+}
+
+// Prints a query reply starting with its first frame and reads the rest.
+// JSON frames are joined into a single array; binary records are written
+// to stdout as they arrive.
+static bool print_query(const ClientCommand *cmd, uint32_t id, TMResponse *res) {
+    if (!res->success) {
+        print_response(cmd, id, res);
+        return false;
+    }
+    bool binary = cmd->flags & REQ_BINARY;
+    bool first = true;
+    if (!binary) {
+        printf("{\"id\":%u,\"command\":", id);
+        print_json_string(cmd->line);
+        printf(",\"success\":true,\"processes\":[");
+    }
+    for (;;) {
+        if (binary) {
+            fwrite(res->response, 1, res->length, stdout);
+        } else if (res->response[0]) {
+            printf("%s%s", first ? "" : ",", res->response);
+            first = false;
+        }
+        if (!res->more) break;
+        if (!recv_response(res) || res->id != id) {
+            if (!binary) printf("]}\n");
+            fprintf(stderr, "Error: Query reply for '%s' was cut short\n", cmd->line);
+            disconnect_from_daemon();
+            return false;
+        }
+    }
+    if (!binary) printf("]}\n");
+    fflush(stdout);
+    return true;
+}
 
-    send(fd, &req, sizeof(req), 0);
+static bool send_command(const ClientCommand *cmd) {
+    if (!ensure_connected()) return false;
+
+    uint32_t id = send_request(cmd);
+    if (id == 0) {
+        // The daemon may have dropped an idle connection; retry once on a fresh one.
+        disconnect_from_daemon();
+        if (!ensure_connected()) return false;
+        id = send_request(cmd);
+    }
 
     TMResponse res;
-    memset(&res, 0, sizeof(res));
-    if (recv(fd, &res, sizeof(res), 0) > 0) {
-        printf("%s", res.response);
-    } else {
-        fprintf(stderr, "Error: No response from daemon\n");
+    if (id == 0 || !recv_response(&res) || res.id != id) {
+        print_response(cmd, id, NULL);
+        disconnect_from_daemon();
+        return false;
     }
+    if (cmd->type == CMD_QUERY) return print_query(cmd, id, &res);
+    print_response(cmd, id, &res);
+    return res.success;
+}
 
+// Copies a consistent snapshot of the status board. Returns the number of
+// entries, or -1 if no board is published.
+static int read_status_board(BoardEntry **out, pid_t *daemon_pid) {
+    int fd = shm_open(STATUS_BOARD_NAME, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    StatusBoard *board = MAP_FAILED;
+    size_t mapped = 0;
+    BoardEntry *entries = NULL;
+    int count = -1;
+    for (int tries = 0; tries < BOARD_READ_TRIES; tries++) {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(StatusBoard)) break;
+        if (board == MAP_FAILED || mapped < (size_t)st.st_size) {
+            if (board != MAP_FAILED) munmap(board, mapped);
+            mapped = st.st_size;
+            board = mmap(NULL, mapped, PROT_READ, MAP_SHARED, fd, 0);
+            if (board == MAP_FAILED) break;
+        }
+        if (board->magic != STATUS_BOARD_MAGIC || board->version != STATUS_BOARD_VERSION) break;
+
+        uint32_t seq = __atomic_load_n(&board->seq, __ATOMIC_ACQUIRE);
+        uint32_t n = board->num_entries;
+        if ((seq & 1) || sizeof(StatusBoard) + n * sizeof(BoardEntry) > mapped) {
+            sched_yield();
+            continue;
+        }
+        BoardEntry *copy = realloc(entries, (n ? n : 1) * sizeof(BoardEntry));
+        if (!copy) break;
+        entries = copy;
+        memcpy(entries, board->entries, n * sizeof(BoardEntry));
+        *daemon_pid = board->daemon_pid;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&board->seq, __ATOMIC_RELAXED) == seq) {
+            count = n;
+            break;
+        }
+    }
+
+    if (board != MAP_FAILED) munmap(board, mapped);
     close(fd);
+    if (count < 0) free(entries);
+    else *out = entries;
+    return count;
 }
 
-void handle_client_line(char *line) {
-    char *saveptr;
-    char *cmd = strtok_r(line, " \n", &saveptr);
-    if (!cmd) return;
-
-    if (strcmp(cmd, "status") == 0) {
-        send_command(CMD_STATUS, NULL);
-    } else if (strcmp(cmd, "start") == 0) {
-        char *name = strtok_r(NULL, " \n", &saveptr);
-        if (name) send_command(CMD_START, name);
-    } else if (strcmp(cmd, "stop") == 0) {
-        char *name = strtok_r(NULL, " \n", &saveptr);
-        if (name) send_command(CMD_STOP, name);
-    } else if (strcmp(cmd, "restart") == 0) {
-        char *name = strtok_r(NULL, " \n", &saveptr);
-        if (name) send_command(CMD_RESTART, name);
-    } else if (strcmp(cmd, "reload") == 0) {
-        send_command(CMD_RELOAD, NULL);
-    } else if (strcmp(cmd, "shutdown") == 0) {
-        send_command(CMD_SHUTDOWN, NULL);
-    } else if (strcmp(cmd, "exit") == 0 || strcmp(cmd, "quit") == 0) {
-        exit(0);
+// status --fast: reads the board without sending the daemon a request.
+static bool print_fast_status(const ClientCommand *cmd) {
+    BoardEntry *entries = NULL;
+    pid_t daemon_pid = 0;
+    int n = read_status_board(&entries, &daemon_pid);
+    if (n < 0) {
+        fprintf(stderr, "Error: No status board at %s (is the daemon running?)\n", STATUS_BOARD_NAME);
+        return false;
+    }
+    if (kill(daemon_pid, 0) != 0 && errno == ESRCH) {
+        fprintf(stderr, "Error: Status board is stale, daemon %d is gone\n", daemon_pid);
+        free(entries);
+        return false;
+    }
+
+    if (g_json) {
+        printf("{\"command\":");
+        print_json_string(cmd->line);
+        printf(",\"success\":true,\"processes\":[");
     } else {
-        printf("Unknown command: %s\n", cmd);
+        printf("%-20s %-10s %-10s %-20s\n", "NAME", "INDEX", "STATE", "INFO");
+    }
+    bool first = true;
+    for (int i = 0; i < n; i++) {
+        BoardEntry *e = &entries[i];
+        if (e->flags & BOARD_PARKED) continue;
+        if (g_json) {
+            printf("%s{\"name\":", first ? "" : ",");
+            print_json_string(e->name);
+            printf(",\"index\":%d,\"state\":\"%s\",\"pid\":%d,\"restarts\":%d,\"start_time\":%lld,\"stop_time\":%lld,\"pending\":%s,\"deferred\":%s}",
+                   e->index, e->state, e->pid, e->restart_count, (long long)e->start_time, (long long)e->stop_time,
+                   (e->flags & BOARD_PENDING) ? "true" : "false", (e->flags & BOARD_DEFERRED) ? "true" : "false");
+        } else {
+            printf("%-20s %-10d %-10s pid %d restarts %d%s\n", e->name, e->index, e->state, e->pid, e->restart_count,
+                   (e->flags & BOARD_DEFERRED) ? " (deferred by pressure)" :
+                   (e->flags & BOARD_PENDING) ? " (waiting on dependencies)" : "");
+        }
+        first = false;
+    }
+    if (g_json) printf("]}\n");
+    free(entries);
+    return true;
+}
+
+// Parses one command line. Returns 1 for a request, 0 for an empty line,
+// -1 for exit/quit and -2 for an unknown or incomplete command.
+static int parse_command_line(const char *line, ClientCommand *cmd) {
+    char buf[MAX_CMD_LEN];
+    strncpy(buf, line, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    memset(cmd, 0, sizeof(*cmd));
+    char *saveptr;
+    char *name = strtok_r(buf, " \t\n", &saveptr);
+    if (!name) return 0;
+
+    char *arg = strtok_r(NULL, " \t\n", &saveptr);
+    if (strcmp(name, "status") == 0) cmd->type = CMD_STATUS;
+    else if (strcmp(name, "start") == 0) cmd->type = CMD_START;
+    else if (strcmp(name, "stop") == 0) cmd->type = CMD_STOP;
+    else if (strcmp(name, "restart") == 0) cmd->type = CMD_RESTART;
+    else if (strcmp(name, "reload") == 0) cmd->type = CMD_RELOAD;
+    else if (strcmp(name, "shutdown") == 0) cmd->type = CMD_SHUTDOWN;
+    else if (strcmp(name, "history") == 0) cmd->type = CMD_HISTORY;
+    else if (strcmp(name, "scale") == 0) cmd->type = CMD_SCALE;
+    else if (strcmp(name, "stats") == 0) cmd->type = CMD_STATS;
+    else if (strcmp(name, "query") == 0) cmd->type = CMD_QUERY;
+    else if (strcmp(name, "exit") == 0 || strcmp(name, "quit") == 0) return -1;
+    else return -2;
+
+    if (cmd->type == CMD_START || cmd->type == CMD_STOP || cmd->type == CMD_RESTART ||
+        cmd->type == CMD_HISTORY) {
+        if (!arg) return -2;
+        strncpy(cmd->payload, arg, sizeof(cmd->payload) - 1);
+    }
+    if (cmd->type == CMD_STATUS && arg && strcmp(arg, "--fast") == 0) cmd->fast = true;
+    // In JSON, status is an unfiltered query so it carries one record per instance
+    if (cmd->type == CMD_STATUS && g_json && !cmd->fast) cmd->type = CMD_QUERY;
+    if (cmd->type == CMD_QUERY) {
+        // The rest of the line is the filter, passed to the daemon as is
+        if (arg && strcmp(arg, "--binary") == 0) {
+            cmd->flags |= REQ_BINARY;
+            arg = strtok_r(NULL, "\n", &saveptr);
+        } else if (arg) {
+            char *rest = strtok_r(NULL, "\n", &saveptr);
+            if (rest) arg[strlen(arg)] = ' ';
+        }
+        if (arg && strlen(arg) >= sizeof(cmd->payload)) return -2;
+        if (arg) strncpy(cmd->payload, arg, sizeof(cmd->payload) - 1);
+        snprintf(cmd->line, sizeof(cmd->line), "%s%s%s%s", name, cmd->flags & REQ_BINARY ? " --binary" : "",
+                 arg ? " " : "", arg ? arg : "");
+        return 1;
+    }
+    if (cmd->type == CMD_SCALE) {
+        char *count = strtok_r(NULL, " \t\n", &saveptr);
+        if (!arg || !count) return -2;
+        snprintf(cmd->payload, sizeof(cmd->payload), "%.40s %.20s", arg, count);
+        snprintf(cmd->line, sizeof(cmd->line), "%s %s", name, cmd->payload);
+        return 1;
+    }
+    snprintf(cmd->line, sizeof(cmd->line), "%s%s%s", name, arg ? " " : "", arg ? arg : "");
+    return 1;
+}
+
+static bool handle_client_line(const char *line) {
+    ClientCommand cmd;
+    int ret = parse_command_line(line, &cmd);
+    if (ret == -1) exit(0);
+    if (ret == -2) {
+        printf("Unknown command: %s", line);
+        if (line[strlen(line) - 1] != '\n') printf("\n");
+        return false;
+    }
+    if (ret == 0) return true;
+    if (cmd.fast) return print_fast_status(&cmd);
+    return send_command(&cmd);
+}
+
+// Reads every command from `in` and pipelines them over a single connection,
+// keeping up to BATCH_WINDOW requests in flight. Replies are matched back to
+// their command by request id.
+static int run_batch(FILE *in) {
+    ClientCommand *cmds = NULL;
+    int num_cmds = 0, cap = 0;
+    bool failed = false;
+    char line[MAX_CMD_LEN];
+    int line_num = 0;
+
+    while (fgets(line, sizeof(line), in)) {
+        line_num++;
+        if (num_cmds == cap) {
+            cap = cap ? cap * 2 : 64;
+            ClientCommand *grown = realloc(cmds, sizeof(ClientCommand) * cap);
+            if (!grown) {
+                fprintf(stderr, "Error: out of memory reading batch\n");
+                free(cmds);
+                return 1;
+            }
+            cmds = grown;
+        }
+        int ret = parse_command_line(line, &cmds[num_cmds]);
+        if (ret == -1) break;
+        if (ret == -2) {
+            fprintf(stderr, "Error: line %d: unknown command: %s", line_num, line);
+            failed = true;
+            continue;
+        }
+        if (ret == 1) num_cmds++;
+    }
+
+    if (num_cmds == 0 || !ensure_connected()) {
+        free(cmds);
+        return (failed || num_cmds > 0) ? 1 : 0;
+    }
+
+    uint32_t first_id = g_next_id;
+    int sent = 0, received = 0;
+    while (received < num_cmds) {
+        while (sent < num_cmds && sent - received < BATCH_WINDOW) {
+            if (send_request(&cmds[sent]) == 0) break;
+            sent++;
+        }
+
+        TMResponse res;
+        if (received == sent || !recv_response(&res)) break;
+        uint32_t slot = res.id - first_id;
+        if (slot >= (uint32_t)sent) {
+            fprintf(stderr, "Error: response with unknown request id %u\n", res.id);
+            break;
+        }
+        if (cmds[slot].type == CMD_QUERY) {
+            if (!print_query(&cmds[slot], res.id, &res)) failed = true;
+        } else {
+            print_response(&cmds[slot], res.id, &res);
+            if (!res.success) failed = true;
+        }
+        received++;
+    }
+
+    for (int i = received; i < num_cmds; i++) {
+        print_response(&cmds[i], first_id + i, NULL);
+        failed = true;
     }
+
+    disconnect_from_daemon();
+    free(cmds);
+    return failed ? 1 : 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-j|--json] [-b|--batch [FILE]] [command [args]]\n", prog);
 }
 
 int main(int argc, char **argv) {
-    if (argc > 1) {
+    const char *batch_path = NULL;
+    bool batch = false;
+    int argi = 1;
+
+    for (; argi < argc && argv[argi][0] == '-'; argi++) {
+        if (strcmp(argv[argi], "-j") == 0 || strcmp(argv[argi], "--json") == 0) {
+            g_json = true;
+        } else if (strcmp(argv[argi], "-b") == 0 || strcmp(argv[argi], "--batch") == 0) {
+            batch = true;
+            if (argi + 1 < argc && argv[argi + 1][0] != '-') batch_path = argv[++argi];
+        } else if (strcmp(argv[argi], "-") == 0) {
+            break;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (batch) {
+        FILE *in = stdin;
+        if (batch_path && strcmp(batch_path, "-") != 0) {
+            in = fopen(batch_path, "r");
+            if (!in) {
+                perror("fopen");
+                return 1;
+            }
+        }
+        int ret = run_batch(in);
+        if (in != stdin) fclose(in);
+        return ret;
+    }
+
+    if (argi < argc) {
         char cmd_buf[MAX_CMD_LEN] = {0};
-        for (int i = 1; i < argc; i++) {
+        for (int i = argi; i < argc; i++) {
             strncat(cmd_buf, argv[i], MAX_CMD_LEN - strlen(cmd_buf) - 1);
             if (i < argc - 1) strncat(cmd_buf, " ", MAX_CMD_LEN - strlen(cmd_buf) - 1);
         }
-        handle_client_line(cmd_buf);
-        return 0;
+        return handle_client_line(cmd_buf) ? 0 : 1;
     }
 
     char line[256];
@@ -88,9 +453,11 @@ int main(int argc, char **argv) {
     fflush(stdout);
     while (fgets(line, sizeof(line), stdin)) {
         handle_client_line(line);
+        disconnect_from_daemon();
         printf("taskmasterctl> ");
         fflush(stdout);
     }
 
+    disconnect_from_daemon();
     return 0;
 }
@@ -0,0 +1,160 @@
+#include "taskmaster.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+static Process *find_slot(Taskmaster *tm, ProgramConfig *cfg, int index) {
+    for (int i = 0; i < tm->num_processes; i++) {
+        if (tm->processes[i].config == cfg && tm->processes[i].proc_index == index) return &tm->processes[i];
+    }
+    return NULL;
+}
+
+// Grows or shrinks the active instance set of a program. Slots keep their
+// proc_index: growing starts the next parked slots, shrinking stops the
+// highest active ones. Returns the instance count actually applied.
+int scale_program(Taskmaster *tm, ProgramConfig *cfg, int target, const char *reason) {
+    if (target < cfg->numprocs_min) target = cfg->numprocs_min;
+    if (target > cfg->numprocs_max) target = cfg->numprocs_max;
+    if (target == cfg->active_procs) return target;
+
+    log_event("Scaling %s from %d to %d instances (%s)", cfg->name, cfg->active_procs, target, reason);
+    for (int idx = cfg->active_procs; idx < target; idx++) {
+        Process *proc = find_slot(tm, cfg, idx);
+        if (proc) schedule_start(proc);
+    }
+    for (int idx = cfg->active_procs - 1; idx >= target; idx--) {
+        Process *proc = find_slot(tm, cfg, idx);
+        if (proc) stop_process(proc);
+    }
+    cfg->active_procs = target;
+    cfg->last_scale = time(NULL);
+    return target;
+}
+
+static bool read_cpu_ticks(pid_t pid, unsigned long long *ticks) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+
+    char buf[1024];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+
+    // utime and stime are fields 14 and 15; skip past the command name
+    char *p = strrchr(buf, ')');
+    unsigned long long utime, stime;
+    if (!p || sscanf(p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2) return false;
+    *ticks = utime + stime;
+    return true;
+}
+
+// Average cpu utilization in percent per live instance since the previous
+// sample. Returns -1 until two samples are available.
+static double sample_cpu(Taskmaster *tm, ProgramConfig *cfg) {
+    unsigned long long ticks = 0;
+    int live = 0;
+    for (int i = 0; i < tm->num_processes; i++) {
+        Process *proc = &tm->processes[i];
+        unsigned long long t;
+        if (proc->config != cfg || proc->pid <= 0) continue;
+        if (read_cpu_ticks(proc->pid, &t)) {
+            ticks += t;
+            live++;
+        }
+    }
+
+    uint64_t now_us = monotonic_us();
+    double load = -1;
+    if (cfg->cpu_sample_us > 0 && live > 0 && ticks >= cfg->cpu_ticks) {
+        double seconds = (now_us - cfg->cpu_sample_us) / 1e6;
+        double used = (ticks - cfg->cpu_ticks) / (double)sysconf(_SC_CLK_TCK);
+        if (seconds > 0) load = used / seconds * 100.0 / live;
+    }
+    cfg->cpu_ticks = ticks;
+    cfg->cpu_sample_us = now_us;
+    return load;
+}
+
+static bool read_queue_file(const char *path, long *depth) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    bool ok = fscanf(f, "%ld", depth) == 1;
+    fclose(f);
+    return ok;
+}
+
+// The peer is expected to write the current queue depth and close.
+static bool read_queue_socket(const char *path, long *depth) {
+    struct sockaddr_un addr;
+    size_t len = strlen(path);
+    if (len >= sizeof(addr.sun_path)) return false;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, len);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+
+    struct timeval tv = {0, 100000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    char buf[64];
+    ssize_t n = -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) n = recv(fd, buf, sizeof(buf) - 1, 0);
+    close(fd);
+    if (n <= 0) return false;
+    buf[n] = '\0';
+
+    char *end;
+    *depth = strtol(buf, &end, 10);
+    return end != buf;
+}
+
+static double sample_signal(Taskmaster *tm, ProgramConfig *cfg) {
+    long depth;
+    switch (cfg->scale_signal) {
+        case SCALE_CPU:
+            return sample_cpu(tm, cfg);
+        case SCALE_QUEUE_FILE:
+            if (!read_queue_file(cfg->scale_source, &depth)) return -1;
+            break;
+        case SCALE_QUEUE_SOCKET:
+            if (!read_queue_socket(cfg->scale_source, &depth)) return -1;
+            break;
+        default:
+            return -1;
+    }
+    return (double)depth / (cfg->active_procs > 0 ? cfg->active_procs : 1);
+}
+
+// Samples each autoscaled program every scale_interval seconds and moves it
+// one instance at a time. Load above scale_up grows, below scale_down shrinks;
+// the band between them and the cooldown keep it from flapping.
+void update_autoscale(Taskmaster *tm) {
+    time_t now = time(NULL);
+    for (int i = 0; i < tm->num_configs; i++) {
+        ProgramConfig *cfg = &tm->configs[i];
+        if (cfg->scale_signal == SCALE_MANUAL || cfg->numprocs_min == cfg->numprocs_max) continue;
+        if (now - cfg->last_sample < cfg->scale_interval) continue;
+        cfg->last_sample = now;
+
+        double load = sample_signal(tm, cfg);
+        if (load < 0) continue;
+        cfg->last_load = load;
+        if (now - cfg->last_scale < cfg->scale_cooldown) continue;
+
+        char reason[MAX_NAME_LEN];
+        if (load > cfg->scale_up && cfg->active_procs < cfg->numprocs_max) {
+            snprintf(reason, sizeof(reason), "load %.1f above %.1f", load, cfg->scale_up);
+            scale_program(tm, cfg, cfg->active_procs + 1, reason);
+        } else if (load < cfg->scale_down && cfg->active_procs > cfg->numprocs_min) {
+            snprintf(reason, sizeof(reason), "load %.1f below %.1f", load, cfg->scale_down);
+            scale_program(tm, cfg, cfg->active_procs - 1, reason);
+        }
+    }
+}
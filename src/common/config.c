@@ -25,6 +25,108 @@ static int get_signal_number(const char *sig) {
     return SIGTERM;
 }
 
+static void add_dependency(ProgramConfig *config, const char *name, const char *path, int line_num) {
+    if (name[0] == '\0') return;
+    if (config->num_depends >= MAX_DEPS) {
+        log_event("Config warning in %s at line %d: too many dependencies for '%s'", path, line_num, config->name);
+        return;
+    }
+    strncpy(config->depends_on[config->num_depends++], name, MAX_NAME_LEN - 1);
+}
+
+// Accepts "a, b" as well as the flow form "[a, b]".
+static void parse_dependency_list(ProgramConfig *config, char *value, const char *path, int line_num) {
+    char *saveptr;
+    for (char *tok = strtok_r(value, "[], ", &saveptr); tok; tok = strtok_r(NULL, "[], ", &saveptr)) {
+        add_dependency(config, trim_whitespace(tok), path, line_num);
+    }
+}
+
+static int get_sched_policy(const char *policy) {
+    if (strcmp(policy, "other") == 0) return SCHED_OTHER;
+    if (strcmp(policy, "batch") == 0) return SCHED_BATCH;
+    if (strcmp(policy, "idle") == 0) return SCHED_IDLE;
+    if (strcmp(policy, "fifo") == 0) return SCHED_FIFO;
+    if (strcmp(policy, "rr") == 0) return SCHED_RR;
+    return -1;
+}
+
+// Accepts "idle", "be/N" or "rt/N" with N in 0..7.
+static bool parse_ioprio(const char *value, ProgramConfig *config) {
+    if (strcmp(value, "idle") == 0) {
+        config->ioprio_class = IOPRIO_CLASS_IDLE;
+        config->ioprio_level = 0;
+        return true;
+    }
+    int level = 4;
+    if (strncmp(value, "be", 2) == 0) config->ioprio_class = IOPRIO_CLASS_BE;
+    else if (strncmp(value, "rt", 2) == 0) config->ioprio_class = IOPRIO_CLASS_RT;
+    else return false;
+    if (value[2] == '/') level = atoi(value + 3);
+    else if (value[2] != '\0') return false;
+    if (level < 0 || level > 7) return false;
+    config->ioprio_level = level;
+    return true;
+}
+
+static void parse_scale_signal(ProgramConfig *config, const char *value, const char *path, int line_num) {
+    if (strcmp(value, "manual") == 0) config->scale_signal = SCALE_MANUAL;
+    else if (strcmp(value, "cpu") == 0) config->scale_signal = SCALE_CPU;
+    else if (strncmp(value, "file:", 5) == 0) config->scale_signal = SCALE_QUEUE_FILE;
+    else if (strncmp(value, "socket:", 7) == 0) config->scale_signal = SCALE_QUEUE_SOCKET;
+    else {
+        log_event("Config warning in %s at line %d: unknown scale_signal '%s'", path, line_num, value);
+        return;
+    }
+    const char *source = strchr(value, ':');
+    strncpy(config->scale_source, source ? source + 1 : "", MAX_CMD_LEN - 1);
+}
+
+// Fills in scaling bounds once a program is fully parsed: without
+// numprocs_min/numprocs_max the program is fixed at numprocs.
+static void finish_program(ProgramConfig *config, const char *path) {
+    if (config->numprocs_min < 0) config->numprocs_min = config->numprocs;
+    if (config->numprocs_max < 0) config->numprocs_max = config->numprocs;
+    if (config->numprocs_max < config->numprocs_min) {
+        log_event("Config warning in %s: numprocs_max of '%s' is below numprocs_min", path, config->name);
+        config->numprocs_max = config->numprocs_min;
+    }
+    if (config->numprocs < config->numprocs_min) config->numprocs = config->numprocs_min;
+    if (config->numprocs > config->numprocs_max) config->numprocs = config->numprocs_max;
+    if (config->scale_down >= config->scale_up && config->numprocs_min != config->numprocs_max &&
+        config->scale_signal != SCALE_MANUAL) {
+        log_event("Config warning in %s: scale_down of '%s' should be below scale_up", path, config->name);
+    }
+    config->active_procs = config->numprocs;
+}
+
+// Keys of the top-level `pressure:` section
+static void parse_pressure_key(const char *path, int line_num, char *trimmed, PressureConfig *cfg) {
+    char *colon = strchr(trimmed, ':');
+    if (!colon) return;
+    *colon = '\0';
+    char *key = trimmed;
+    char *value = trim_whitespace(colon + 1);
+    if (value[0] == '"') {
+        value++;
+        char *end = strrchr(value, '"');
+        if (end) *end = '\0';
+    }
+
+    if (strcmp(key, "memory") == 0) cfg->threshold[PRESSURE_MEMORY] = atof(value);
+    else if (strcmp(key, "cpu") == 0) cfg->threshold[PRESSURE_CPU] = atof(value);
+    else if (strcmp(key, "memory_source") == 0) strncpy(cfg->source[PRESSURE_MEMORY], value, MAX_CMD_LEN - 1);
+    else if (strcmp(key, "cpu_source") == 0) strncpy(cfg->source[PRESSURE_CPU], value, MAX_CMD_LEN - 1);
+    else if (strcmp(key, "window_ms") == 0) cfg->window_ms = atoi(value);
+    else if (strcmp(key, "critical_priority") == 0) cfg->critical_priority = atoi(value);
+    else if (strcmp(key, "admit_rate") == 0) cfg->admit_rate = atoi(value);
+    else log_event("Config warning in %s at line %d: unknown pressure key '%s'", path, line_num, key);
+
+    // The kernel accepts trigger windows between 500 ms and 10 s
+    if (cfg->window_ms < 500) cfg->window_ms = 500;
+    if (cfg->window_ms > 10000) cfg->window_ms = 10000;
+}
+
 void parse_config(const char *path, Taskmaster *tm) {
     FILE *file = fopen(path, "r");
     if (!file) {
@@ -39,7 +141,9 @@ void parse_config(const char *path, Taskmaster *tm) {
 
     char line[MAX_CMD_LEN];
     ProgramConfig *current_config = NULL;
+    int first_config = tm->num_configs;
     int line_num = 0;
+    bool in_pressure = false;
 
     while (fgets(line, sizeof(line), file)) {
         line_num++;
@@ -47,6 +151,15 @@ void parse_config(const char *path, Taskmaster *tm) {
         int current_indent = (int)(trimmed - line);
         if (trimmed[0] == '#' || trimmed[0] == '\0') continue;
 
+        if (current_indent == 0) {
+            in_pressure = strncmp(trimmed, "pressure:", 9) == 0;
+            if (in_pressure) current_config = NULL;
+        }
+        if (in_pressure) {
+            if (current_indent > 0) parse_pressure_key(path, line_num, trimmed, &tm->pressure.cfg);
+            continue;
+        }
+
         if (strncmp(trimmed, "programs:", 9) == 0) continue;
 
         // Check for program name (indented)
@@ -60,7 +173,13 @@ void parse_config(const char *path, Taskmaster *tm) {
                 // List of known properties to avoid misidentification
                 const char *props[] = {"cmd", "numprocs", "umask", "workingdir", "autostart", 
                                        "autorestart", "exitcodes", "startretries", "starttime", 
-                                       "stopsignal", "stoptime", "stdout", "stderr", "env", "user", NULL};
+                                       "stopsignal", "stoptime", "stdout", "stderr", "env", "user",
+                                       "depends_on", "cpu_affinity", "nice", "sched_policy",
+                                       "sched_priority", "ioprio", "ready", "numprocs_min", "numprocs_max",
+                                       "scale_signal", "scale_up", "scale_down", "scale_interval",
+                                       "scale_cooldown", "priority", "group", "output_bytes_per_sec",
+                                       "output_lines_per_sec", "output_burst", "output_overflow",
+                                       "output_sample_every", NULL};
                 bool is_prop = false;
                 for (int i = 0; props[i]; i++) {
                     if (strcmp(name, props[i]) == 0) {
@@ -77,10 +196,21 @@ void parse_config(const char *path, Taskmaster *tm) {
                     }
                     current_config = &tm->configs[tm->num_configs++];
                     memset(current_config, 0, sizeof(ProgramConfig));
-                    strncpy(current_config->name, name, MAX_NAME_LEN - 1);
+                    snprintf(current_config->name, MAX_NAME_LEN, "%s", name);
                     current_config->numprocs = 1;
                     current_config->stopsignal = SIGTERM;
+                    current_config->stoptime = 10;
                     current_config->autostart = true;
+                    current_config->sched_policy = -1;
+                    current_config->numprocs_min = -1;
+                    current_config->numprocs_max = -1;
+                    current_config->scale_up = 80;
+                    current_config->scale_down = 20;
+                    current_config->scale_interval = 5;
+                    current_config->scale_cooldown = 30;
+                    current_config->priority = 999;
+                    current_config->output_burst = 1;
+                    current_config->output_sample_every = 100;
                     continue;
                 }
             }
@@ -107,12 +237,34 @@ void parse_config(const char *path, Taskmaster *tm) {
                         strncpy(current_config->cmd, value, MAX_CMD_LEN - 1);
                     } else if (strcmp(key, "numprocs") == 0) {
                         if (value) current_config->numprocs = atoi(value);
+                    } else if (strcmp(key, "numprocs_min") == 0) {
+                        if (value) current_config->numprocs_min = atoi(value);
+                    } else if (strcmp(key, "numprocs_max") == 0) {
+                        if (value) current_config->numprocs_max = atoi(value);
+                    } else if (strcmp(key, "scale_signal") == 0) {
+                        if (value) parse_scale_signal(current_config, value, path, line_num);
+                    } else if (strcmp(key, "scale_up") == 0) {
+                        if (value) current_config->scale_up = atof(value);
+                    } else if (strcmp(key, "scale_down") == 0) {
+                        if (value) current_config->scale_down = atof(value);
+                    } else if (strcmp(key, "scale_interval") == 0) {
+                        if (value) current_config->scale_interval = atoi(value);
+                    } else if (strcmp(key, "scale_cooldown") == 0) {
+                        if (value) current_config->scale_cooldown = atoi(value);
                     } else if (strcmp(key, "umask") == 0) {
                         if (value) current_config->umask = strtol(value, NULL, 8);
                     } else if (strcmp(key, "workingdir") == 0) {
                         if (value) strncpy(current_config->workingdir, value, MAX_CMD_LEN - 1);
                     } else if (strcmp(key, "autostart") == 0) {
                         if (value) current_config->autostart = (strcmp(value, "true") == 0);
+                    } else if (strcmp(key, "ready") == 0) {
+                        if (value) {
+                            if (strcmp(value, "notify") == 0) current_config->ready_notify = true;
+                            else if (strcmp(value, "starttime") == 0) current_config->ready_notify = false;
+                            else log_event("Config warning in %s at line %d: unknown ready mode '%s'", path, line_num, value);
+                        }
+                    } else if (strcmp(key, "group") == 0) {
+                        if (value) strncpy(current_config->group, value, MAX_NAME_LEN - 1);
                     } else if (strcmp(key, "user") == 0) {
                         if (value) strncpy(current_config->user, value, MAX_NAME_LEN - 1);
                     } else if (strcmp(key, "autorestart") == 0) {
@@ -191,6 +343,71 @@ void parse_config(const char *path, Taskmaster *tm) {
                                 break;
                             }
                         }
+                    } else if (strcmp(key, "cpu_affinity") == 0) {
+                        if (!value) continue;
+                        cpu_set_t set;
+                        strncpy(current_config->cpu_affinity, value, MAX_NAME_LEN - 1);
+                        if (strcmp(value, "per_index") == 0) current_config->affinity_mode = AFFINITY_PER_INDEX;
+                        else if (strcmp(value, "numa_spread") == 0) current_config->affinity_mode = AFFINITY_NUMA_SPREAD;
+                        else if (parse_cpu_list(value, &set)) current_config->affinity_mode = AFFINITY_LIST;
+                        else log_event("Config warning in %s at line %d: invalid cpu_affinity '%s'", path, line_num, value);
+                    } else if (strcmp(key, "nice") == 0) {
+                        if (value) {
+                            current_config->nice = atoi(value);
+                            current_config->has_nice = true;
+                        }
+                    } else if (strcmp(key, "sched_policy") == 0) {
+                        if (value) {
+                            current_config->sched_policy = get_sched_policy(value);
+                            if (current_config->sched_policy < 0)
+                                log_event("Config warning in %s at line %d: unknown sched_policy '%s'", path, line_num, value);
+                        }
+                    } else if (strcmp(key, "sched_priority") == 0) {
+                        if (value) current_config->sched_priority = atoi(value);
+                    } else if (strcmp(key, "priority") == 0) {
+                        if (value) current_config->priority = atoi(value);
+                    } else if (strcmp(key, "output_bytes_per_sec") == 0) {
+                        if (value) current_config->output_bytes_per_sec = atof(value);
+                    } else if (strcmp(key, "output_lines_per_sec") == 0) {
+                        if (value) current_config->output_lines_per_sec = atof(value);
+                    } else if (strcmp(key, "output_burst") == 0) {
+                        if (value && atoi(value) > 0) current_config->output_burst = atoi(value);
+                    } else if (strcmp(key, "output_overflow") == 0) {
+                        if (value) {
+                            if (strcmp(value, "drop") == 0) current_config->output_overflow = OUTPUT_DROP;
+                            else if (strcmp(value, "sample") == 0) current_config->output_overflow = OUTPUT_SAMPLE;
+                            else log_event("Config warning in %s at line %d: unknown output_overflow '%s'", path, line_num, value);
+                        }
+                    } else if (strcmp(key, "output_sample_every") == 0) {
+                        if (value && atoi(value) > 0) current_config->output_sample_every = atoi(value);
+                    } else if (strcmp(key, "ioprio") == 0) {
+                        if (value && !parse_ioprio(value, current_config)) {
+                            current_config->ioprio_class = IOPRIO_CLASS_NONE;
+                            log_event("Config warning in %s at line %d: invalid ioprio '%s'", path, line_num, value);
+                        }
+                    } else if (strcmp(key, "depends_on") == 0) {
+                        if (value && value[0] != '\0') {
+                            parse_dependency_list(current_config, value, path, line_num);
+                            continue;
+                        }
+                        long pos = ftell(file);
+                        char next_line[MAX_CMD_LEN];
+                        while (fgets(next_line, sizeof(next_line), file)) {
+                            line_num++;
+                            char *trimmed_next = trim_whitespace(next_line);
+                            int next_indent = (int)(trimmed_next - next_line);
+                            if (trimmed_next[0] == '\0') {
+                                pos = ftell(file);
+                                continue;
+                            }
+                            if (next_indent <= current_indent || trimmed_next[0] != '-') {
+                                fseek(file, pos, SEEK_SET);
+                                line_num--;
+                                break;
+                            }
+                            add_dependency(current_config, trim_whitespace(trimmed_next + 1), path, line_num);
+                            pos = ftell(file);
+                        }
                     } else if (strcmp(key, "starttime") == 0) {
                         if (value) current_config->starttime = atoi(value);
                     } else if (strcmp(key, "startretries") == 0) {
@@ -212,6 +429,8 @@ void parse_config(const char *path, Taskmaster *tm) {
         }
     }
     fclose(file);
+
+    for (int i = first_config; i < tm->num_configs; i++) finish_program(&tm->configs[i], path);
 }
 
 void parse_config_dir(const char *path, Taskmaster *tm) {
@@ -239,6 +458,10 @@ static bool configs_equal(ProgramConfig *a, ProgramConfig *b) {
     if (strcmp(a->name, b->name) != 0) return false;
     if (strcmp(a->cmd, b->cmd) != 0) return false;
     if (a->numprocs != b->numprocs) return false;
+    if (a->numprocs_min != b->numprocs_min || a->numprocs_max != b->numprocs_max) return false;
+    if (a->scale_signal != b->scale_signal || strcmp(a->scale_source, b->scale_source) != 0) return false;
+    if (a->scale_up != b->scale_up || a->scale_down != b->scale_down) return false;
+    if (a->scale_interval != b->scale_interval || a->scale_cooldown != b->scale_cooldown) return false;
     if (a->umask != b->umask) return false;
     if (strcmp(a->workingdir, b->workingdir) != 0) return false;
     if (a->autostart != b->autostart) return false;
@@ -254,6 +477,21 @@ static bool configs_equal(ProgramConfig *a, ProgramConfig *b) {
     for (int i = 0; i < a->num_exitcodes; i++) {
         if (a->exitcodes[i] != b->exitcodes[i]) return false;
     }
+    if (a->ready_notify != b->ready_notify) return false;
+    if (a->affinity_mode != b->affinity_mode) return false;
+    if (strcmp(a->cpu_affinity, b->cpu_affinity) != 0) return false;
+    if (a->has_nice != b->has_nice || a->nice != b->nice) return false;
+    if (a->sched_policy != b->sched_policy || a->sched_priority != b->sched_priority) return false;
+    if (a->ioprio_class != b->ioprio_class || a->ioprio_level != b->ioprio_level) return false;
+    if (a->priority != b->priority) return false;
+    if (strcmp(a->group, b->group) != 0) return false;
+    if (a->output_bytes_per_sec != b->output_bytes_per_sec || a->output_lines_per_sec != b->output_lines_per_sec) return false;
+    if (a->output_burst != b->output_burst || a->output_overflow != b->output_overflow) return false;
+    if (a->output_sample_every != b->output_sample_every) return false;
+    if (a->num_depends != b->num_depends) return false;
+    for (int i = 0; i < a->num_depends; i++) {
+        if (strcmp(a->depends_on[i], b->depends_on[i]) != 0) return false;
+    }
     if (a->num_env != b->num_env) return false;
     for (int i = 0; i < a->num_env; i++) {
         if (strcmp(a->env[i], b->env[i]) != 0) return false;
@@ -268,15 +506,76 @@ static int find_config_index(ProgramConfig *configs, int num_configs, const char
     return -1;
 }
 
+// Resolves depends_on names into indices and assigns every program its
+// startup wave: wave 0 has no dependencies, wave N depends only on programs
+// in earlier waves. Returns false if the graph contains a cycle.
+bool resolve_dependencies(Taskmaster *tm) {
+    for (int i = 0; i < tm->num_configs; i++) {
+        ProgramConfig *cfg = &tm->configs[i];
+        cfg->num_dep_index = 0;
+        cfg->wave = -1;
+        for (int d = 0; d < cfg->num_depends; d++) {
+            int idx = find_config_index(tm->configs, tm->num_configs, cfg->depends_on[d]);
+            if (idx < 0) {
+                log_event("Config warning: program '%s' depends on unknown program '%s'", cfg->name, cfg->depends_on[d]);
+                continue;
+            }
+            cfg->dep_index[cfg->num_dep_index++] = idx;
+        }
+    }
+
+    int placed = 0;
+    for (int wave = 0; placed < tm->num_configs; wave++) {
+        int placed_in_wave = 0;
+        for (int i = 0; i < tm->num_configs; i++) {
+            ProgramConfig *cfg = &tm->configs[i];
+            if (cfg->wave >= 0) continue;
+            bool ready = true;
+            for (int d = 0; d < cfg->num_dep_index; d++) {
+                int dep_wave = tm->configs[cfg->dep_index[d]].wave;
+                if (dep_wave < 0 || dep_wave >= wave) { ready = false; break; }
+            }
+            if (ready) {
+                cfg->wave = wave;
+                placed_in_wave++;
+            }
+        }
+        if (placed_in_wave == 0) break;
+        placed += placed_in_wave;
+    }
+
+    if (placed == tm->num_configs) return true;
+
+    char names[MAX_CMD_LEN] = {0};
+    for (int i = 0; i < tm->num_configs; i++) {
+        if (tm->configs[i].wave >= 0) continue;
+        if (names[0]) strncat(names, ", ", sizeof(names) - strlen(names) - 1);
+        strncat(names, tm->configs[i].name, sizeof(names) - strlen(names) - 1);
+    }
+    log_event("Config error: dependency cycle detected involving: %s", names);
+    return false;
+}
+
+// A reload replaces a dependency's instances when the program is removed or
+// restarted
+static bool dependency_replaced(ProgramConfig *old_configs, int old_num_configs, Taskmaster *next_tm,
+                                const bool *restarted, const char *name) {
+    if (find_config_index(old_configs, old_num_configs, name) < 0) return false;
+    int j = find_config_index(next_tm->configs, next_tm->num_configs, name);
+    return j < 0 || restarted[j];
+}
+
 static int total_processes_for_configs(ProgramConfig *configs, int num_configs) {
     int total = 0;
-    for (int i = 0; i < num_configs; i++) total += configs[i].numprocs;
+    for (int i = 0; i < num_configs; i++) total += configs[i].numprocs_max;
     return total;
 }
 
 void reload_config(Taskmaster *tm, const char *config_path) {
+    uint64_t reload_start = monotonic_us();
     Taskmaster next_tm;
     memset(&next_tm, 0, sizeof(Taskmaster));
+    default_pressure_config(&next_tm.pressure.cfg);
     
     struct stat st;
     if (stat(config_path, &st) == 0 && S_ISDIR(st.st_mode)) {
@@ -287,6 +586,12 @@ void reload_config(Taskmaster *tm, const char *config_path) {
 
     log_event("Reloading configuration from %s", config_path);
 
+    if (!resolve_dependencies(&next_tm)) {
+        log_event("Reload failed: keeping previous configuration");
+        free(next_tm.configs);
+        return;
+    }
+
     ProgramConfig *old_configs = tm->configs;
     int old_num_configs = tm->num_configs;
     Process *old_processes = tm->processes;
@@ -296,86 +601,171 @@ void reload_config(Taskmaster *tm, const char *config_path) {
     Process *new_processes = NULL;
     bool *old_used = NULL;
     bool *preserved = NULL;
+    bool *relaunch = NULL;
+    bool *restarted = NULL;
+    int *old_base = NULL;
 
     if (new_num_processes > 0) {
         new_processes = calloc(new_num_processes, sizeof(Process));
         preserved = calloc(new_num_processes, sizeof(bool));
+        relaunch = calloc(new_num_processes, sizeof(bool));
     }
     if (old_num_processes > 0) old_used = calloc(old_num_processes, sizeof(bool));
+    if (old_num_configs > 0) old_base = calloc(old_num_configs, sizeof(int));
+    if (next_tm.num_configs > 0) restarted = calloc(next_tm.num_configs, sizeof(bool));
 
-    if ((new_num_processes > 0 && (!new_processes || !preserved)) ||
-        (old_num_processes > 0 && !old_used)) {
+    if ((new_num_processes > 0 && (!new_processes || !preserved || !relaunch)) ||
+        (old_num_processes > 0 && !old_used) || (old_num_configs > 0 && !old_base) ||
+        (next_tm.num_configs > 0 && !restarted)) {
         log_event("Reload failed: memory allocation failure");
         free(new_processes);
         free(preserved);
+        free(relaunch);
+        free(restarted);
         free(old_used);
+        free(old_base);
         free(next_tm.configs);
         return;
     }
 
+    // Slots are laid out per program in proc_index order, so an old instance
+    // is found at its program's base offset plus its index.
+    for (int i = 1; i < old_num_configs; i++) old_base[i] = old_base[i - 1] + old_configs[i - 1].numprocs_max;
+
+    // Changed programs are restarted, and so are the programs depending on a
+    // restarted or removed one, so no instance outlives its dependency
+    for (int i = 0; i < next_tm.num_configs; i++) {
+        int old_cfg_idx = find_config_index(old_configs, old_num_configs, next_tm.configs[i].name);
+        restarted[i] = old_cfg_idx >= 0 && !configs_equal(&old_configs[old_cfg_idx], &next_tm.configs[i]);
+    }
+    for (bool progress = true; progress;) {
+        progress = false;
+        for (int i = 0; i < next_tm.num_configs; i++) {
+            ProgramConfig *cfg = &next_tm.configs[i];
+            if (restarted[i] || find_config_index(old_configs, old_num_configs, cfg->name) < 0) continue;
+            for (int d = 0; d < cfg->num_depends; d++) {
+                if (!dependency_replaced(old_configs, old_num_configs, &next_tm, restarted, cfg->depends_on[d])) continue;
+                log_event("Restarting %s because its dependency %s is replaced", cfg->name, cfg->depends_on[d]);
+                restarted[i] = true;
+                progress = true;
+                break;
+            }
+        }
+    }
+
     int dst_index = 0;
     for (int i = 0; i < next_tm.num_configs; i++) {
         int old_cfg_idx = find_config_index(old_configs, old_num_configs, next_tm.configs[i].name);
-        bool unchanged = false;
-        if (old_cfg_idx >= 0) {
-            unchanged = configs_equal(&old_configs[old_cfg_idx], &next_tm.configs[i]);
+        bool same = old_cfg_idx >= 0 && configs_equal(&old_configs[old_cfg_idx], &next_tm.configs[i]);
+        bool unchanged = same && !restarted[i];
+        if (same) {
+            ProgramConfig *old = &old_configs[old_cfg_idx];
+            ProgramConfig *cfg = &next_tm.configs[i];
+            cfg->active_procs = old->active_procs;
+            cfg->last_scale = old->last_scale;
+            cfg->last_sample = old->last_sample;
+            cfg->last_load = old->last_load;
+            cfg->cpu_ticks = old->cpu_ticks;
+            cfg->cpu_sample_us = old->cpu_sample_us;
+            cfg->deferred_starts = old->deferred_starts;
+            cfg->byte_tokens = old->byte_tokens;
+            cfg->line_tokens = old->line_tokens;
+            cfg->output_refill_us = old->output_refill_us;
+            cfg->suppressed_bytes = old->suppressed_bytes;
+            cfg->suppressed_lines = old->suppressed_lines;
+            cfg->sampled_lines = old->sampled_lines;
         }
 
-        for (int inst = 0; inst < next_tm.configs[i].numprocs; inst++) {
+        for (int inst = 0; inst < next_tm.configs[i].numprocs_max; inst++) {
             Process *dst = &new_processes[dst_index];
-            if (unchanged) {
-                for (int j = 0; j < old_num_processes; j++) {
-                    if (old_used[j]) continue;
-                    if (old_processes[j].config == &old_configs[old_cfg_idx] &&
-                        old_processes[j].proc_index == inst) {
-                        *dst = old_processes[j];
-                        dst->config = &next_tm.configs[i];
-                        old_used[j] = true;
-                        preserved[dst_index] = true;
-                        break;
-                    }
-                }
+            int j = -1;
+            if (old_cfg_idx >= 0 && inst < old_configs[old_cfg_idx].numprocs_max) j = old_base[old_cfg_idx] + inst;
+            if (unchanged && j >= 0) {
+                *dst = old_processes[j];
+                dst->config = &next_tm.configs[i];
+                old_used[j] = true;
+                preserved[dst_index] = true;
             }
             if (!preserved[dst_index]) {
                 dst->config = &next_tm.configs[i];
                 dst->proc_index = inst;
                 dst->state = STATE_STOPPED;
+                // Keep the event history of a changed program's instance
+                if (j >= 0) {
+                    memcpy(dst->history, old_processes[j].history, sizeof(dst->history));
+                    dst->history_next = old_processes[j].history_next;
+                    dst->history_count = old_processes[j].history_count;
+                }
+                // An instance restarted only for its dependency comes back
+                // even without autostart
+                if (same && j >= 0) relaunch[dst_index] = old_processes[j].pid > 0 || old_processes[j].start_pending;
             }
             dst_index++;
         }
     }
 
-    // Stop processes that are no longer represented in the new config
+    // Instances no longer represented in the new config are retained until
+    // reaped so their stoptime is still enforced and shutdown waits for
+    // them. The scheduler stops them dependents first, like stop all.
+    ProgramConfig **config_copies = old_num_configs > 0 ? calloc(old_num_configs, sizeof(ProgramConfig *)) : NULL;
     for (int i = 0; i < old_num_processes; i++) {
         if (old_used[i]) continue;
-        if (old_processes[i].pid > 0) {
-            log_event("Stopping outdated process %s[%d] during reload",
+        if (old_processes[i].pid <= 0) {
+            close_output(&old_processes[i]);
+            continue;
+        }
+        log_event("Stopping outdated process %s[%d] during reload",
+                  old_processes[i].config->name, old_processes[i].proc_index);
+        Process *kept = NULL;
+        if (config_copies) kept = retire_process(tm, &old_processes[i], &config_copies[old_processes[i].config - old_configs]);
+        if (!kept) {
+            log_event("Reload: cannot track %s[%d] until it exits: memory allocation failure",
                       old_processes[i].config->name, old_processes[i].proc_index);
-            stop_process(&old_processes[i]);
+            close_output(&old_processes[i]);
+            if (old_processes[i].state != STATE_STOPPING) stop_process(&old_processes[i]);
+            continue;
         }
+        kept->start_pending = false;
+        kept->deferred = false;
+        if (kept->state != STATE_STOPPING) kept->stop_pending = true;
     }
+    free(config_copies);
 
     // Swap process/config tables
     tm->configs = next_tm.configs;
     tm->num_configs = next_tm.num_configs;
     tm->processes = new_processes;
     tm->num_processes = new_num_processes;
+    rebuild_pid_index(tm);
+    rebuild_program_index(tm);
+    if (memcmp(&tm->pressure.cfg, &next_tm.pressure.cfg, sizeof(PressureConfig)) != 0) {
+        close_pressure(tm);
+        tm->pressure.cfg = next_tm.pressure.cfg;
+        setup_pressure(tm);
+    }
 
-    // Autostart new/changed process instances
+    // Autostart new/changed process instances once their dependencies run
+    begin_convergence(tm);
     for (int i = 0; i < tm->num_processes; i++) {
         if (preserved[i]) continue;
-        if (tm->processes[i].config->autostart) {
+        if ((tm->processes[i].config->autostart || relaunch[i]) &&
+            tm->processes[i].proc_index < tm->processes[i].config->active_procs) {
             log_event("Starting process %s[%d] due to reload",
                       tm->processes[i].config->name, tm->processes[i].proc_index);
-            start_process(&tm->processes[i]);
+            schedule_start(&tm->processes[i]);
         }
     }
 
-    log_event("Reload complete (applied %d programs, %d process slots)",
-              tm->num_configs, tm->num_processes);
+    uint64_t elapsed = monotonic_us() - reload_start;
+    record_timing(&tm->stats.reload, elapsed);
+    log_event("Reload complete (applied %d programs, %d process slots) in %llu us",
+              tm->num_configs, tm->num_processes, (unsigned long long)elapsed);
 
     free(old_used);
+    free(old_base);
     free(preserved);
+    free(relaunch);
+    free(restarted);
     free(old_processes);
     free(old_configs);
 }
@@ -0,0 +1,262 @@
+#include "taskmaster.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define OUTPUT_CHUNK 65536
+#define OUTPUT_READ_MAX (1024 * 1024) // per stream and wake-up
+#define MARKER_INTERVAL_US 1000000
+
+bool output_limited(const ProgramConfig *cfg) {
+    return cfg->output_bytes_per_sec > 0 || cfg->output_lines_per_sec > 0;
+}
+
+static bool any_limited(const Taskmaster *tm) {
+    if (tm->num_retired > 0) return true;
+    for (int i = 0; i < tm->num_configs; i++) {
+        if (output_limited(&tm->configs[i])) return true;
+    }
+    return false;
+}
+
+// Instances a reload dropped keep their streams until they are reaped
+static Process *nth_process(Taskmaster *tm, int i) {
+    return i < tm->num_processes ? &tm->processes[i] : tm->retired[i - tm->num_processes];
+}
+
+static void refill(ProgramConfig *cfg, uint64_t now) {
+    double bytes_cap = cfg->output_bytes_per_sec * cfg->output_burst;
+    double lines_cap = cfg->output_lines_per_sec * cfg->output_burst;
+    if (cfg->output_refill_us == 0) {
+        cfg->byte_tokens = bytes_cap;
+        cfg->line_tokens = lines_cap;
+    } else if (now > cfg->output_refill_us) {
+        double elapsed = (now - cfg->output_refill_us) / 1e6;
+        cfg->byte_tokens += cfg->output_bytes_per_sec * elapsed;
+        cfg->line_tokens += cfg->output_lines_per_sec * elapsed;
+        if (cfg->byte_tokens > bytes_cap) cfg->byte_tokens = bytes_cap;
+        if (cfg->line_tokens > lines_cap) cfg->line_tokens = lines_cap;
+    }
+    cfg->output_refill_us = now;
+}
+
+static void write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        buf += n;
+        len -= n;
+    }
+}
+
+static void write_marker(OutputStream *os) {
+    if (os->pending_bytes == 0) return;
+    char marker[160];
+    int len = snprintf(marker, sizeof(marker), "%s[taskmaster] %llu bytes suppressed (%llu lines, output over budget)\n",
+                       os->cut ? "\n" : "", os->pending_bytes, os->pending_lines);
+    write_all(os->file_fd, marker, len);
+    os->pending_bytes = 0;
+    os->pending_lines = 0;
+    os->cut = false;
+}
+
+static void suppress(ProgramConfig *cfg, OutputStream *os, size_t bytes, uint64_t now) {
+    if (os->pending_bytes == 0) os->marker_us = now;
+    os->pending_bytes += bytes;
+    cfg->suppressed_bytes += bytes;
+}
+
+// Decides the fate of a whole line when it begins: it goes through while
+// both buckets have budget, otherwise it is dropped, or kept as a sample
+// once every output_sample_every suppressed lines.
+static void begin_line(ProgramConfig *cfg, OutputStream *os) {
+    bool lines_ok = cfg->output_lines_per_sec <= 0 || cfg->line_tokens >= 1;
+    bool bytes_ok = cfg->output_bytes_per_sec <= 0 || cfg->byte_tokens >= 1;
+    os->sampling = false;
+    os->dropping = !(lines_ok && bytes_ok);
+    if (!os->dropping) {
+        if (cfg->output_lines_per_sec > 0) cfg->line_tokens -= 1;
+        return;
+    }
+    if (cfg->output_overflow == OUTPUT_SAMPLE && ++os->skipped >= (unsigned long long)cfg->output_sample_every) {
+        os->skipped = 0;
+        os->dropping = false;
+        os->sampling = true;
+        cfg->sampled_lines++;
+        return;
+    }
+    os->pending_lines++;
+    cfg->suppressed_lines++;
+}
+
+static void consume(ProgramConfig *cfg, OutputStream *os, const char *buf, size_t len, uint64_t now) {
+    size_t pos = 0;
+    while (pos < len) {
+        const char *nl = memchr(buf + pos, '\n', len - pos);
+        size_t seg = (nl ? (size_t)(nl - buf) + 1 : len) - pos;
+        if (!os->mid_line) begin_line(cfg, os);
+
+        if (os->dropping) {
+            suppress(cfg, os, seg, now);
+        } else {
+            // Sampled lines always go through whole; others are cut where
+            // the byte budget runs out
+            size_t allow = seg;
+            if (!os->sampling && cfg->output_bytes_per_sec > 0 && cfg->byte_tokens < seg)
+                allow = cfg->byte_tokens > 0 ? (size_t)cfg->byte_tokens : 0;
+            if (allow > 0) {
+                write_marker(os);
+                write_all(os->file_fd, buf + pos, allow);
+            }
+            if (cfg->output_bytes_per_sec > 0) cfg->byte_tokens -= allow;
+            if (allow < seg) {
+                os->dropping = true;
+                os->cut = allow > 0 || os->mid_line;
+                suppress(cfg, os, seg - allow, now);
+            }
+        }
+        os->mid_line = nl == NULL;
+        pos += seg;
+    }
+}
+
+static void release(OutputStream *os) {
+    write_marker(os);
+    close(os->pipe_fd);
+    close(os->file_fd);
+    memset(os, 0, sizeof(*os));
+}
+
+// Reads what the stream has buffered, up to OUTPUT_READ_MAX. Returns false
+// once the child side is closed.
+static bool read_stream(ProgramConfig *cfg, OutputStream *os) {
+    char buf[OUTPUT_CHUNK];
+    size_t total = 0;
+    while (total < OUTPUT_READ_MAX) {
+        ssize_t n = read(os->pipe_fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+        if (n == 0) return false;
+        uint64_t now = monotonic_us();
+        refill(cfg, now);
+        consume(cfg, os, buf, n, now);
+        total += n;
+    }
+    return true;
+}
+
+// Called before fork. Opens the log files in the daemon and gives the child
+// the write end of a pipe instead; child_fds[k] stays -1 for streams the
+// child should open itself.
+void prepare_output(Process *proc, int child_fds[2]) {
+    child_fds[0] = child_fds[1] = -1;
+    close_output(proc);
+    if (!output_limited(proc->config)) return;
+
+    for (int k = 0; k < 2; k++) {
+        const char *path = k == 0 ? proc->config->stdout_path : proc->config->stderr_path;
+        if (path[0] == '\0') continue;
+        int file_fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (file_fd < 0) continue;
+        int p[2];
+        if (pipe2(p, O_CLOEXEC) != 0) {
+            close(file_fd);
+            continue;
+        }
+        // select() cannot watch it; the child writes the file directly
+        if (p[0] >= FD_SETSIZE) {
+            log_event("Output of %s[%d] is not rate limited: too many open descriptors",
+                      proc->config->name, proc->proc_index);
+            close(p[0]);
+            close(p[1]);
+            close(file_fd);
+            continue;
+        }
+        OutputStream *os = &proc->output[k];
+        memset(os, 0, sizeof(*os));
+        os->captured = true;
+        os->pipe_fd = p[0];
+        os->file_fd = file_fd;
+        child_fds[k] = p[1];
+    }
+}
+
+// Called in the daemon after fork
+void attach_output(Process *proc, int child_fds[2], bool spawned) {
+    for (int k = 0; k < 2; k++) {
+        if (child_fds[k] < 0) continue;
+        close(child_fds[k]);
+        OutputStream *os = &proc->output[k];
+        if (spawned) fcntl(os->pipe_fd, F_SETFL, O_NONBLOCK);
+        else release(os);
+    }
+}
+
+int output_fds(Taskmaster *tm, fd_set *fds, int max_fd) {
+    if (!any_limited(tm)) return max_fd;
+    for (int i = 0; i < tm->num_processes + tm->num_retired; i++) {
+        for (int k = 0; k < 2; k++) {
+            OutputStream *os = &nth_process(tm, i)->output[k];
+            if (!os->captured) continue;
+            FD_SET(os->pipe_fd, fds);
+            if (os->pipe_fd > max_fd) max_fd = os->pipe_fd;
+        }
+    }
+    return max_fd;
+}
+
+void handle_output(Taskmaster *tm, fd_set *fds) {
+    if (!any_limited(tm)) return;
+    for (int i = 0; i < tm->num_processes + tm->num_retired; i++) {
+        Process *proc = nth_process(tm, i);
+        for (int k = 0; k < 2; k++) {
+            OutputStream *os = &proc->output[k];
+            if (!os->captured || !FD_ISSET(os->pipe_fd, fds)) continue;
+            if (!read_stream(proc->config, os)) release(os);
+        }
+    }
+}
+
+// A stream that keeps flooding gets one marker per interval, and a stream
+// that went quiet gets the marker for its last suppressed run.
+void flush_output_markers(Taskmaster *tm) {
+    if (!any_limited(tm)) return;
+    uint64_t now = monotonic_us();
+    for (int i = 0; i < tm->num_processes + tm->num_retired; i++) {
+        for (int k = 0; k < 2; k++) {
+            OutputStream *os = &nth_process(tm, i)->output[k];
+            if (!os->captured || os->pending_bytes == 0) continue;
+            if (os->mid_line && !os->dropping) continue; // the file is mid-line
+            if (now - os->marker_us < MARKER_INTERVAL_US) continue;
+            write_marker(os);
+        }
+    }
+}
+
+// Drains what the child left in the pipe and closes both ends
+void close_output(Process *proc) {
+    for (int k = 0; k < 2; k++) {
+        OutputStream *os = &proc->output[k];
+        if (!os->captured) continue;
+        read_stream(proc->config, os);
+        release(os);
+    }
+}
+
+void describe_output_limits(const Taskmaster *tm, char *buf, size_t len) {
+    size_t used = 0;
+    buf[0] = '\0';
+    for (int i = 0; i < tm->num_configs && used < len; i++) {
+        const ProgramConfig *cfg = &tm->configs[i];
+        if (!output_limited(cfg)) continue;
+        used += snprintf(buf + used, len - used, "%s %s %llu bytes/%llu lines suppressed",
+                         used ? "," : "output:", cfg->name, cfg->suppressed_bytes, cfg->suppressed_lines);
+        if (cfg->output_overflow == OUTPUT_SAMPLE && used < len)
+            used += snprintf(buf + used, len - used, " %llu sampled", cfg->sampled_lines);
+    }
+    if (used > 0 && used < len) snprintf(buf + used, len - used, "\n");
+}
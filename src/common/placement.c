@@ -0,0 +1,188 @@
+#include "taskmaster.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_SHIFT 13
+#define MAX_NUMA_NODES 64
+
+// Parses a kernel-style cpu list such as "0-3,8,10-11".
+bool parse_cpu_list(const char *list, cpu_set_t *set) {
+    CPU_ZERO(set);
+    const char *p = list;
+    while (*p) {
+        while (*p == ' ' || *p == ',') p++;
+        if (*p == '\0' || *p == '\n') break;
+        if (!isdigit((unsigned char)*p)) return false;
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (*end == '-') {
+            p = end + 1;
+            if (!isdigit((unsigned char)*p)) return false;
+            last = strtol(p, &end, 10);
+        }
+        if (first < 0 || last < first || last >= CPU_SETSIZE) return false;
+        for (long cpu = first; cpu <= last; cpu++) CPU_SET(cpu, set);
+        p = end;
+    }
+    return CPU_COUNT(set) > 0;
+}
+
+static void format_cpu_list(const cpu_set_t *set, char *buf, size_t len) {
+    size_t used = 0;
+    buf[0] = '\0';
+    for (int cpu = 0; cpu < CPU_SETSIZE && used < len; cpu++) {
+        if (!CPU_ISSET(cpu, set)) continue;
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, set)) last++;
+        int n = (last > cpu)
+            ? snprintf(buf + used, len - used, "%s%d-%d", used ? "," : "", cpu, last)
+            : snprintf(buf + used, len - used, "%s%d", used ? "," : "", cpu);
+        if (n < 0) break;
+        used += n;
+        cpu = last;
+    }
+}
+
+static int nth_cpu(const cpu_set_t *set, int n) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, set) && n-- == 0) return cpu;
+    }
+    return -1;
+}
+
+// Collects the cpu set of every NUMA node that has cpus. Returns the node count.
+static int read_numa_nodes(cpu_set_t *nodes, int max_nodes) {
+    DIR *dir = opendir("/sys/devices/system/node");
+    if (!dir) return 0;
+
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && count < max_nodes) {
+        if (strncmp(entry->d_name, "node", 4) != 0 || !isdigit((unsigned char)entry->d_name[4])) continue;
+        char path[MAX_CMD_LEN];
+        char list[MAX_CMD_LEN];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/%s/cpulist", entry->d_name);
+        FILE *f = fopen(path, "r");
+        if (!f) continue;
+        if (fgets(list, sizeof(list), f) && parse_cpu_list(list, &nodes[count])) count++;
+        fclose(f);
+    }
+    closedir(dir);
+    return count;
+}
+
+// Works out the cpu set an instance should be pinned to. Runs in the daemon
+// before fork so the child only has to apply the result.
+bool plan_placement(const Process *proc, cpu_set_t *set) {
+    const ProgramConfig *cfg = proc->config;
+    cpu_set_t allowed;
+
+    switch (cfg->affinity_mode) {
+        case AFFINITY_LIST:
+            return parse_cpu_list(cfg->cpu_affinity, set);
+        case AFFINITY_PER_INDEX: {
+            if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return false;
+            int cpu = nth_cpu(&allowed, proc->proc_index % CPU_COUNT(&allowed));
+            if (cpu < 0) return false;
+            CPU_ZERO(set);
+            CPU_SET(cpu, set);
+            return true;
+        }
+        case AFFINITY_NUMA_SPREAD: {
+            cpu_set_t nodes[MAX_NUMA_NODES];
+            if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return false;
+            int num_nodes = read_numa_nodes(nodes, MAX_NUMA_NODES);
+            if (num_nodes == 0) {
+                *set = allowed;
+                return true;
+            }
+            CPU_AND(set, &nodes[proc->proc_index % num_nodes], &allowed);
+            if (CPU_COUNT(set) == 0) *set = nodes[proc->proc_index % num_nodes];
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// Applies affinity, nice, scheduling class and I/O priority in the forked
+// child. Runs before privileges are dropped; failures are reported on the
+// program's stderr but do not prevent it from starting.
+void apply_placement(const ProgramConfig *cfg, const cpu_set_t *set) {
+    if (set && sched_setaffinity(0, sizeof(*set), set) != 0) perror("sched_setaffinity");
+
+    if (cfg->sched_policy >= 0) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = cfg->sched_priority;
+        if (sched_setscheduler(0, cfg->sched_policy, &param) != 0) perror("sched_setscheduler");
+    }
+    if (cfg->has_nice && setpriority(PRIO_PROCESS, 0, cfg->nice) != 0) perror("setpriority");
+
+    if (cfg->ioprio_class > 0) {
+        int prio = (cfg->ioprio_class << IOPRIO_CLASS_SHIFT) | cfg->ioprio_level;
+        if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, prio) != 0) perror("ioprio_set");
+    }
+}
+
+const char *sched_policy_to_string(int policy) {
+    switch (policy) {
+        case SCHED_OTHER: return "other";
+        case SCHED_BATCH: return "batch";
+        case SCHED_IDLE: return "idle";
+        case SCHED_FIFO: return "fifo";
+        case SCHED_RR: return "rr";
+        default: return "unknown";
+    }
+}
+
+static const char *ioprio_class_to_string(int cls) {
+    switch (cls) {
+        case IOPRIO_CLASS_RT: return "rt";
+        case IOPRIO_CLASS_BE: return "be";
+        case IOPRIO_CLASS_IDLE: return "idle";
+        default: return "none";
+    }
+}
+
+// Describes the placement a running instance actually has, as read back from
+// the kernel. Empty when the program does not configure any placement.
+void describe_placement(const Process *proc, char *buf, size_t len) {
+    const ProgramConfig *cfg = proc->config;
+    buf[0] = '\0';
+    if (proc->pid <= 0) return;
+    if (cfg->affinity_mode == AFFINITY_NONE && !cfg->has_nice && cfg->sched_policy < 0 && cfg->ioprio_class == 0) return;
+
+    size_t used = 0;
+    cpu_set_t set;
+    if (cfg->affinity_mode != AFFINITY_NONE && sched_getaffinity(proc->pid, sizeof(set), &set) == 0) {
+        char cpus[MAX_NAME_LEN];
+        format_cpu_list(&set, cpus, sizeof(cpus));
+        used += snprintf(buf + used, len - used, " cpus %s", cpus);
+    }
+    if (cfg->has_nice && used < len) {
+        errno = 0;
+        int nice = getpriority(PRIO_PROCESS, proc->pid);
+        if (errno == 0) used += snprintf(buf + used, len - used, " nice %d", nice);
+    }
+    if (cfg->sched_policy >= 0 && used < len) {
+        int policy = sched_getscheduler(proc->pid);
+        if (policy >= 0) used += snprintf(buf + used, len - used, " sched %s", sched_policy_to_string(policy));
+    }
+    if (cfg->ioprio_class > 0 && used < len) {
+        long prio = syscall(SYS_ioprio_get, IOPRIO_WHO_PROCESS, proc->pid);
+        if (prio >= 0) {
+            snprintf(buf + used, len - used, " io %s/%ld",
+                     ioprio_class_to_string((int)(prio >> IOPRIO_CLASS_SHIFT)), prio & 0xff);
+        }
+    }
+}
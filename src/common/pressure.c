@@ -0,0 +1,200 @@
+#include "taskmaster.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/vfs.h>
+
+#define PROC_SUPER_MAGIC 0x9fa0
+#define CGROUP2_SUPER_MAGIC 0x63677270
+
+static const char *resource_names[PRESSURE_RESOURCES] = { "memory", "cpu" };
+
+void default_pressure_config(PressureConfig *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    strcpy(cfg->source[PRESSURE_MEMORY], "/proc/pressure/memory");
+    strcpy(cfg->source[PRESSURE_CPU], "/proc/pressure/cpu");
+    cfg->window_ms = 2000;
+    cfg->critical_priority = 100;
+    cfg->admit_rate = 1;
+}
+
+// Reads the "some" line of a PSI file. total is -1 when the file has no
+// total= field.
+static bool read_pressure(int fd, double *avg10, long long *total) {
+    char buf[256];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return false;
+    buf[n] = '\0';
+    if (sscanf(buf, "some avg10=%lf", avg10) != 1) return false;
+    char *p = strstr(buf, "total=");
+    char *eol = strchr(buf, '\n');
+    *total = (p && (!eol || p < eol)) ? atoll(p + 6) : -1;
+    return true;
+}
+
+// Arms a kernel PSI trigger. Only PSI files on procfs or cgroupfs accept
+// triggers; anything else (e.g. a file written by a test) is polled.
+static bool arm_trigger(int fd, double threshold, int window_ms) {
+    struct statfs fs;
+    if (fstatfs(fd, &fs) != 0 || (fs.f_type != PROC_SUPER_MAGIC && fs.f_type != CGROUP2_SUPER_MAGIC)) return false;
+
+    char trigger[64];
+    long window_us = window_ms * 1000L;
+    long stall_us = (long)(window_us * threshold / 100.0);
+    if (stall_us <= 0) stall_us = 1;
+    int len = snprintf(trigger, sizeof(trigger), "some %ld %ld", stall_us, window_us);
+    return write(fd, trigger, len + 1) > 0;
+}
+
+void setup_pressure(Taskmaster *tm) {
+    PressureState *ps = &tm->pressure;
+    for (int r = 0; r < PRESSURE_RESOURCES; r++) {
+        ps->fds[r] = -1;
+        ps->trigger[r] = false;
+        ps->level[r] = 0;
+        ps->sample_us[r] = 0;
+        if (ps->cfg.threshold[r] <= 0) continue;
+
+        int fd = open(ps->cfg.source[r], O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) fd = open(ps->cfg.source[r], O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            log_event("Pressure monitoring for %s unavailable: cannot open %s", resource_names[r], ps->cfg.source[r]);
+            continue;
+        }
+        ps->fds[r] = fd;
+        ps->trigger[r] = arm_trigger(fd, ps->cfg.threshold[r], ps->cfg.window_ms);
+        log_event("Monitoring %s pressure above %.1f%% from %s (%s)", resource_names[r],
+                  ps->cfg.threshold[r], ps->cfg.source[r], ps->trigger[r] ? "trigger" : "polling");
+    }
+}
+
+void close_pressure(Taskmaster *tm) {
+    for (int r = 0; r < PRESSURE_RESOURCES; r++) {
+        if (tm->pressure.fds[r] >= 0) close(tm->pressure.fds[r]);
+        tm->pressure.fds[r] = -1;
+    }
+}
+
+// Adds armed trigger fds to an exception set for select(); PSI triggers
+// signal with POLLPRI.
+int pressure_fds(Taskmaster *tm, fd_set *fds, int max_fd) {
+    for (int r = 0; r < PRESSURE_RESOURCES; r++) {
+        if (!tm->pressure.trigger[r]) continue;
+        FD_SET(tm->pressure.fds[r], fds);
+        if (tm->pressure.fds[r] > max_fd) max_fd = tm->pressure.fds[r];
+    }
+    return max_fd;
+}
+
+// Trigger events only wake the daemon early; the decision below is made
+// on the measured stall, so a spurious event cannot defer anything.
+void handle_pressure_events(Taskmaster *tm, fd_set *fds) {
+    for (int r = 0; r < PRESSURE_RESOURCES; r++) {
+        if (tm->pressure.trigger[r] && FD_ISSET(tm->pressure.fds[r], fds)) {
+            update_pressure(tm);
+            return;
+        }
+    }
+}
+
+// The level is the share of time some task stalled since the previous
+// sample, from the PSI total counter; files without one use avg10. It
+// reacts within a sample to pressure rising and, unlike avg10, to it
+// dropping again.
+void update_pressure(Taskmaster *tm) {
+    PressureState *ps = &tm->pressure;
+    uint64_t now = monotonic_us();
+    bool above = false;
+    int worst = -1;
+    for (int r = 0; r < PRESSURE_RESOURCES; r++) {
+        double avg10;
+        long long total;
+        if (ps->fds[r] < 0 || !read_pressure(ps->fds[r], &avg10, &total)) continue;
+        if (total < 0) {
+            ps->level[r] = avg10;
+        } else if (ps->sample_us[r] > 0 && now - ps->sample_us[r] >= 250000) {
+            ps->level[r] = (total - ps->last_total[r]) * 100.0 / (now - ps->sample_us[r]);
+        }
+        if (total < 0 || ps->sample_us[r] == 0 || now - ps->sample_us[r] >= 250000) {
+            ps->last_total[r] = total;
+            ps->sample_us[r] = now;
+        }
+        if (ps->level[r] >= ps->cfg.threshold[r]) {
+            above = true;
+            worst = r;
+        }
+    }
+
+    if (above && !ps->active) {
+        ps->active = true;
+        ps->active_since_us = now;
+        log_event("Resource pressure high (%s %.2f%%): deferring starts above priority %d",
+                  resource_names[worst], ps->level[worst], ps->cfg.critical_priority);
+    } else if (!above && ps->active) {
+        ps->active = false;
+        int waiting = 0;
+        for (int i = 0; i < tm->num_processes; i++) {
+            if (tm->processes[i].deferred) waiting++;
+        }
+        log_event("Resource pressure cleared after %llu ms, resuming %d deferred starts",
+                  (unsigned long long)((now - ps->active_since_us) / 1000), waiting);
+    }
+}
+
+bool pressure_defers(const Taskmaster *tm, const ProgramConfig *cfg) {
+    return tm->pressure.active && cfg->priority > tm->pressure.cfg.critical_priority;
+}
+
+// Under pressure, admit_rate non-critical starts per second go to the most
+// important program waiting (best_waiting is the lowest waiting priority).
+bool pressure_admit(Taskmaster *tm, const ProgramConfig *cfg, int best_waiting) {
+    PressureState *ps = &tm->pressure;
+    if (!pressure_defers(tm, cfg)) return true;
+    if (cfg->priority > best_waiting) return false;
+
+    time_t now = time(NULL);
+    if (now != ps->admit_second) {
+        ps->admit_second = now;
+        ps->admitted = 0;
+    }
+    if (ps->admitted >= ps->cfg.admit_rate) return false;
+    ps->admitted++;
+    return true;
+}
+
+void defer_start(Taskmaster *tm, Process *proc) {
+    proc->start_pending = true;
+    if (proc->deferred) return;
+    proc->deferred = true;
+    proc->config->deferred_starts++;
+    tm->pressure.deferred++;
+    log_event("Deferring start of %s[%d] (priority %d) under resource pressure",
+              proc->config->name, proc->proc_index, proc->config->priority);
+}
+
+// One-line summary for status; empty when pressure monitoring is off.
+void describe_pressure(const Taskmaster *tm, char *buf, size_t len) {
+    const PressureState *ps = &tm->pressure;
+    size_t used = 0;
+    buf[0] = '\0';
+    for (int r = 0; r < PRESSURE_RESOURCES && used < len; r++) {
+        if (ps->fds[r] < 0) continue;
+        used += snprintf(buf + used, len - used, "%s %s %.2f%%/%.2f%%", used ? "," : "pressure:",
+                         resource_names[r], ps->level[r], ps->cfg.threshold[r]);
+    }
+    if (used == 0 || used >= len) return;
+
+    int waiting = 0;
+    for (int i = 0; i < tm->num_processes; i++) {
+        if (tm->processes[i].deferred) waiting++;
+    }
+    used += snprintf(buf + used, len - used, " %s, %d waiting, %llu deferred",
+                     ps->active ? "HIGH" : "ok", waiting, ps->deferred);
+    for (int i = 0; i < tm->num_configs && used < len; i++) {
+        if (tm->configs[i].deferred_starts == 0) continue;
+        used += snprintf(buf + used, len - used, " %s:%llu", tm->configs[i].name, tm->configs[i].deferred_starts);
+    }
+    if (used < len) snprintf(buf + used, len - used, "\n");
+}
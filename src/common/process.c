@@ -5,6 +5,7 @@
 #include <fcntl.h>
 #include <sys/wait.h>
 #include <string.h>
+#include <limits.h>
 
 const char *state_to_string(ProcessState state) {
     switch (state) {
@@ -18,25 +19,95 @@ const char *state_to_string(ProcessState state) {
     }
 }
 
-void start_process(Process *proc) {
-    proc->state = STATE_STARTING;
-    proc->start_time = time(NULL);
-    
+const char *event_to_string(EventType type) {
+    switch (type) {
+        case EVENT_START: return "START";
+        case EVENT_READY: return "READY";
+        case EVENT_EXIT: return "EXIT";
+        case EVENT_SIGNAL: return "SIGNAL";
+        case EVENT_RESTART: return "RESTART";
+        case EVENT_STOP: return "STOP";
+        case EVENT_FATAL: return "FATAL";
+        default: return "UNKNOWN";
+    }
+}
+
+void record_event(Process *proc, EventType type, int value, bool expected) {
+    ProcessEvent *ev = &proc->history[proc->history_next];
+    ev->time = time(NULL);
+    ev->type = type;
+    ev->value = value;
+    ev->expected = expected;
+    ev->runtime_ms = 0;
+    if ((type == EVENT_EXIT || type == EVENT_SIGNAL) && proc->spawn_us > 0) {
+        ev->runtime_ms = (int)((monotonic_us() - proc->spawn_us) / 1000);
+    }
+    proc->history_next = (proc->history_next + 1) % HISTORY_LEN;
+    if (proc->history_count < HISTORY_LEN) proc->history_count++;
+}
+
+void record_timing(Timing *t, uint64_t us) {
+    t->count++;
+    t->total_us += us;
+    if (us > t->max_us) t->max_us = us;
+}
+
+uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// An instance that is still stopping stays pending and is started again
+// once it has been reaped.
+void schedule_start(Process *proc) {
+    proc->stop_pending = false;
+    if (proc->pid > 0 && proc->state != STATE_STOPPING) return;
+    proc->start_pending = true;
+}
+
+void schedule_stop(Process *proc) {
+    proc->start_pending = false;
+    proc->deferred = false;
+    if (proc->pid > 0) proc->stop_pending = true;
+}
+
+void begin_convergence(Taskmaster *tm) {
+    tm->converging = true;
+    tm->converge_start_us = monotonic_us();
+}
+
+// Real backend: fork/exec, kill and waitpid on actual children
+static pid_t real_spawn(Process *proc) {
+    cpu_set_t cpus;
+    bool pinned = plan_placement(proc, &cpus);
+
+    int output_fds[2];
+    prepare_output(proc, output_fds);
+
     pid_t pid = fork();
     if (pid == 0) {
-        // 1. Open files as root (if we are root) before dropping privileges
-        if (strlen(proc->config->stdout_path) > 0) {
+        // 1. Open files as root (if we are root) before dropping privileges;
+        // rate-limited output goes through the daemon instead
+        if (output_fds[0] >= 0) {
+            dup2(output_fds[0], STDOUT_FILENO);
+        } else if (strlen(proc->config->stdout_path) > 0) {
             int fd = open(proc->config->stdout_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
             if (fd >= 0) { dup2(fd, STDOUT_FILENO); close(fd); }
             else { perror("open stdout"); }
         }
-        if (strlen(proc->config->stderr_path) > 0) {
+        if (output_fds[1] >= 0) {
+            dup2(output_fds[1], STDERR_FILENO);
+        } else if (strlen(proc->config->stderr_path) > 0) {
             int fd = open(proc->config->stderr_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
             if (fd >= 0) { dup2(fd, STDERR_FILENO); close(fd); }
             else { perror("open stderr"); }
         }
 
-        // 2. Privilege De-escalation
+        // 2. CPU placement and priorities, while we may still raise them
+        apply_placement(proc->config, pinned ? &cpus : NULL);
+
+        // 3. Privilege De-escalation
         if (strlen(proc->config->user) > 0) {
             struct passwd *pw = getpwnam(proc->config->user);
             if (pw) {
@@ -54,7 +125,8 @@ void start_process(Process *proc) {
             }
         }
 
-        // 3. Set Environment Variables
+        // 4. Set Environment Variables
+        if (proc->config->ready_notify) setenv("NOTIFY_SOCKET", NOTIFY_SOCKET_PATH, 1);
         for (int i = 0; i < proc->config->num_env; i++) {
             char *env_str = strdup(proc->config->env[i]);
             char *key = strtok(env_str, "=");
@@ -83,74 +155,507 @@ void start_process(Process *proc) {
         execvp(args[0], args);
         perror("execvp");
         exit(1);
-    } else if (pid > 0) {
+    }
+    if (pid < 0) perror("fork");
+    attach_output(proc, output_fds, pid > 0);
+    return pid;
+}
+
+static int real_signal(pid_t pid, int sig) {
+    return kill(pid, sig);
+}
+
+static pid_t real_reap(int *status) {
+    return waitpid(-1, status, WNOHANG);
+}
+
+const ProcessBackend real_backend = { "real", real_spawn, real_signal, real_reap, NULL };
+static const ProcessBackend *g_backend = &real_backend;
+
+void set_process_backend(const ProcessBackend *backend) {
+    g_backend = backend;
+}
+
+const ProcessBackend *get_process_backend(void) {
+    return g_backend;
+}
+
+// Open-addressing pid -> Process map so reaping and notify lookups stay
+// O(1) with very large process tables. Rebuilt whenever the table moves.
+typedef struct {
+    pid_t pid;
+    Process *proc;
+} PidSlot;
+
+static PidSlot *g_pid_slots;
+static unsigned g_pid_capacity; // power of two
+static unsigned g_pid_count;
+
+static unsigned pid_hash(pid_t pid) {
+    return ((unsigned)pid * 2654435761u) & (g_pid_capacity - 1);
+}
+
+static void pid_index_insert(pid_t pid, Process *proc);
+
+static void pid_index_grow(void) {
+    PidSlot *old = g_pid_slots;
+    unsigned old_capacity = g_pid_capacity;
+
+    unsigned capacity = old_capacity ? old_capacity * 2 : 64;
+    PidSlot *slots = calloc(capacity, sizeof(PidSlot));
+    if (!slots) return;
+    g_pid_slots = slots;
+    g_pid_capacity = capacity;
+    g_pid_count = 0;
+    for (unsigned i = 0; i < old_capacity; i++) {
+        if (old[i].pid > 0) pid_index_insert(old[i].pid, old[i].proc);
+    }
+    free(old);
+}
+
+static void pid_index_insert(pid_t pid, Process *proc) {
+    if ((g_pid_count + 1) * 2 > g_pid_capacity) pid_index_grow();
+    if (!g_pid_slots) return;
+    unsigned i = pid_hash(pid);
+    while (g_pid_slots[i].pid > 0 && g_pid_slots[i].pid != pid) i = (i + 1) & (g_pid_capacity - 1);
+    if (g_pid_slots[i].pid <= 0) g_pid_count++;
+    g_pid_slots[i].pid = pid;
+    g_pid_slots[i].proc = proc;
+}
+
+// Backward-shift deletion keeps probe chains intact without tombstones
+static void pid_index_remove(pid_t pid) {
+    if (g_pid_count == 0) return;
+    unsigned mask = g_pid_capacity - 1;
+    unsigned i = pid_hash(pid);
+    while (g_pid_slots[i].pid != pid) {
+        if (g_pid_slots[i].pid <= 0) return;
+        i = (i + 1) & mask;
+    }
+    g_pid_slots[i].pid = 0;
+    g_pid_count--;
+
+    for (unsigned j = (i + 1) & mask; g_pid_slots[j].pid > 0; j = (j + 1) & mask) {
+        unsigned home = pid_hash(g_pid_slots[j].pid);
+        bool stays = (i <= j) ? (home > i && home <= j) : (home > i || home <= j);
+        if (stays) continue;
+        g_pid_slots[i] = g_pid_slots[j];
+        g_pid_slots[j].pid = 0;
+        i = j;
+    }
+}
+
+void rebuild_pid_index(Taskmaster *tm) {
+    if (g_pid_slots) memset(g_pid_slots, 0, sizeof(PidSlot) * g_pid_capacity);
+    g_pid_count = 0;
+    for (int i = 0; i < tm->num_processes; i++) {
+        if (tm->processes[i].pid > 0) pid_index_insert(tm->processes[i].pid, &tm->processes[i]);
+    }
+    for (int i = 0; i < tm->num_retired; i++) pid_index_insert(tm->retired[i]->pid, tm->retired[i]);
+}
+
+// The config table of a retired instance is freed by the reload that
+// dropped it, so its instances share a reference-counted copy.
+typedef struct {
+    ProgramConfig config;
+    int refs;
+} RetiredConfig;
+
+// Moves a live instance out of a process table that is about to be freed.
+// config_copy caches the copy of its program's config across the instances
+// of one reload. Returns the retained instance, or NULL if out of memory.
+Process *retire_process(Taskmaster *tm, const Process *proc, ProgramConfig **config_copy) {
+    if (tm->num_retired == tm->retired_cap) {
+        int cap = tm->retired_cap ? tm->retired_cap * 2 : 16;
+        Process **grown = realloc(tm->retired, sizeof(Process *) * cap);
+        if (!grown) return NULL;
+        tm->retired = grown;
+        tm->retired_cap = cap;
+    }
+    if (!*config_copy) {
+        RetiredConfig *rc = malloc(sizeof(RetiredConfig));
+        if (!rc) return NULL;
+        rc->config = *proc->config;
+        rc->config.num_dep_index = 0; // indices into the freed table
+        rc->refs = 0;
+        *config_copy = &rc->config;
+    }
+    Process *kept = malloc(sizeof(Process));
+    if (!kept) return NULL;
+    *kept = *proc;
+    kept->config = *config_copy;
+    kept->retired = true;
+    kept->retired_slot = tm->num_retired;
+    ((RetiredConfig *)kept->config)->refs++;
+    tm->retired[tm->num_retired++] = kept;
+    return kept;
+}
+
+static void drop_retired(Taskmaster *tm, Process *proc) {
+    Process *last = tm->retired[--tm->num_retired];
+    tm->retired[proc->retired_slot] = last;
+    last->retired_slot = proc->retired_slot;
+    RetiredConfig *rc = (RetiredConfig *)proc->config;
+    if (--rc->refs == 0) free(rc);
+    free(proc);
+}
+
+void start_process(Process *proc) {
+    proc->deferred = false;
+    proc->state = STATE_STARTING;
+    proc->start_time = time(NULL);
+    proc->spawn_us = monotonic_us();
+    proc->ready_timed_out = false;
+    proc->notify_status[0] = '\0';
+
+    pid_t pid = g_backend->spawn(proc);
+    if (pid > 0) {
         proc->pid = pid;
+        pid_index_insert(pid, proc);
+        record_event(proc, EVENT_START, pid, false);
         log_event("Started process %s[%d] (PID %d)", proc->config->name, proc->proc_index, pid);
     } else {
-        perror("fork");
         proc->state = STATE_FATAL;
+        record_event(proc, EVENT_FATAL, 0, false);
     }
 }
 
 void stop_process(Process *proc) {
+    proc->start_pending = false;
+    proc->stop_pending = false;
+    proc->deferred = false;
     if (proc->pid > 0) {
         log_event("Stopping process %s[%d] (PID %d) with signal %d", proc->config->name, proc->proc_index, proc->pid, proc->config->stopsignal);
-        kill(proc->pid, proc->config->stopsignal);
+        g_backend->signal(proc->pid, proc->config->stopsignal);
         proc->state = STATE_STOPPING;
+        proc->stop_us = monotonic_us();
+        proc->stop_deadline_us = proc->stop_us + (uint64_t)proc->config->stoptime * 1000000;
+        proc->kill_sent = false;
+        record_event(proc, EVENT_STOP, proc->config->stopsignal, false);
     }
 }
 
+// Signals every live instance at once so the sequence takes as long as the
+// slowest stoptime rather than their sum. Instances already stopping keep
+// their deadline. Returns the number of instances still alive.
+int begin_shutdown(Taskmaster *tm) {
+    tm->shutting_down = true;
+    tm->shutdown_start_us = monotonic_us();
+    for (int i = 0; i < tm->num_configs; i++) {
+        tm->configs[i].stop_count = 0;
+        tm->configs[i].stop_killed = 0;
+        tm->configs[i].stop_total_us = 0;
+        tm->configs[i].stop_max_us = 0;
+    }
+
+    int alive = 0;
+    for (int i = 0; i < tm->num_processes + tm->num_retired; i++) {
+        Process *proc = i < tm->num_processes ? &tm->processes[i] : tm->retired[i - tm->num_processes];
+        proc->start_pending = false;
+        proc->deferred = false;
+        if (proc->pid <= 0) continue;
+        alive++;
+        if (proc->state != STATE_STOPPING) stop_process(proc);
+    }
+    log_event("Shutting down: stopping %d instances", alive);
+    return alive;
+}
+
+// Once every instance is reaped, logs the per-program stop latency and
+// fills report with the same summary.
+bool shutdown_complete(Taskmaster *tm, char *report, size_t len) {
+    if (tm->num_retired > 0) return false;
+    for (int i = 0; i < tm->num_processes; i++) {
+        if (tm->processes[i].pid > 0) return false;
+    }
+
+    uint64_t elapsed = monotonic_us() - tm->shutdown_start_us;
+    size_t used = snprintf(report, len, "Shutdown complete in %llu.%03llu s\n",
+                           (unsigned long long)(elapsed / 1000000), (unsigned long long)(elapsed / 1000 % 1000));
+    log_event("Shutdown complete in %llu.%03llu s",
+              (unsigned long long)(elapsed / 1000000), (unsigned long long)(elapsed / 1000 % 1000));
+    for (int i = 0; i < tm->num_configs && used < len; i++) {
+        ProgramConfig *cfg = &tm->configs[i];
+        if (cfg->stop_count == 0) continue;
+        unsigned long long avg_ms = cfg->stop_total_us / cfg->stop_count / 1000;
+        unsigned long long max_ms = cfg->stop_max_us / 1000;
+        used += snprintf(report + used, len - used, "%-20s %d stopped, avg %llu ms, max %llu ms, %d killed\n",
+                         cfg->name, cfg->stop_count, avg_ms, max_ms, cfg->stop_killed);
+        log_event("Stop latency of %s: %d stopped, avg %llu ms, max %llu ms, %d killed",
+                  cfg->name, cfg->stop_count, avg_ms, max_ms, cfg->stop_killed);
+    }
+    return true;
+}
+
+// Promotes a STARTING instance that reported READY=1. recv_latency_us is the
+// time between the kernel queueing the datagram and the daemon handling it.
+void mark_ready(Process *proc, uint64_t recv_latency_us) {
+    if (proc->state != STATE_STARTING) return;
+    proc->state = STATE_RUNNING;
+    proc->restart_count = 0;
+    record_event(proc, EVENT_READY, 0, false);
+    uint64_t ready_us = monotonic_us() - proc->spawn_us;
+    log_event("Process %s[%d] reported ready after %llu ms (notify latency %llu us)",
+              proc->config->name, proc->proc_index,
+              (unsigned long long)(ready_us / 1000), (unsigned long long)recv_latency_us);
+}
+
+Process *find_process_by_pid(Taskmaster *tm, pid_t pid) {
+    (void)tm;
+    if (pid <= 0 || g_pid_count == 0) return NULL;
+    unsigned i = pid_hash(pid);
+    while (g_pid_slots[i].pid > 0) {
+        if (g_pid_slots[i].pid == pid) return g_pid_slots[i].proc;
+        i = (i + 1) & (g_pid_capacity - 1);
+    }
+    return NULL;
+}
+
+static bool depends_on_config(const ProgramConfig *cfg, int config_idx) {
+    for (int d = 0; d < cfg->num_dep_index; d++) {
+        if (cfg->dep_index[d] == config_idx) return true;
+    }
+    return false;
+}
+
+// Stops instances dropped by a reload once no live dropped instance of a
+// program depending on them is left. Their configs are copies, so the check
+// goes by name. Returns the number of instances stopped.
+static int stop_retired(Taskmaster *tm) {
+    bool pending = false;
+    for (int i = 0; i < tm->num_retired && !pending; i++) pending = tm->retired[i]->stop_pending;
+    if (!pending) return 0;
+
+    const ProgramConfig *dependents[MAX_PROCS];
+    int num_dependents = 0;
+    for (int i = 0; i < tm->num_retired; i++) {
+        const ProgramConfig *cfg = tm->retired[i]->config;
+        if (cfg->num_depends == 0) continue;
+        if (num_dependents > 0 && dependents[num_dependents - 1] == cfg) continue;
+        bool seen = false;
+        for (int k = 0; k < num_dependents && !seen; k++) seen = dependents[k] == cfg;
+        if (!seen && num_dependents < MAX_PROCS) dependents[num_dependents++] = cfg;
+    }
+
+    int changed = 0;
+    for (int i = 0; i < tm->num_retired; i++) {
+        Process *proc = tm->retired[i];
+        if (!proc->stop_pending) continue;
+        bool clear = true;
+        for (int k = 0; k < num_dependents && clear; k++) {
+            for (int d = 0; d < dependents[k]->num_depends; d++) {
+                if (strcmp(dependents[k]->depends_on[d], proc->config->name) == 0) { clear = false; break; }
+            }
+        }
+        if (!clear) continue;
+        stop_process(proc);
+        changed++;
+    }
+    return changed;
+}
+
+// Starts pending instances whose dependencies are all RUNNING, and stops
+// pending instances once no instance of a program depending on them is
+// alive. Under resource pressure non-critical starts are admitted by
+// priority. Returns the number of instances started or stopped.
+static int run_scheduler(Taskmaster *tm) {
+    bool all_running[MAX_PROCS];
+    bool alive[MAX_PROCS];
+    bool announced[MAX_PROCS];
+    bool deps_ready[MAX_PROCS];
+    int best_waiting = INT_MAX;
+    int changed = 0;
+
+    for (int i = 0; i < tm->num_configs; i++) {
+        all_running[i] = tm->configs[i].active_procs > 0;
+        alive[i] = false;
+        announced[i] = false;
+    }
+    for (int i = 0; i < tm->num_processes; i++) {
+        Process *proc = &tm->processes[i];
+        int c = proc->config - tm->configs;
+        // Parked autoscaling slots do not hold back dependents
+        if (proc->state != STATE_RUNNING && proc->proc_index < proc->config->active_procs) all_running[c] = false;
+        if (proc->pid > 0 || proc->start_pending) alive[c] = true;
+    }
+    for (int i = 0; i < tm->num_configs; i++) {
+        ProgramConfig *cfg = &tm->configs[i];
+        deps_ready[i] = true;
+        for (int d = 0; d < cfg->num_dep_index; d++) {
+            if (!all_running[cfg->dep_index[d]]) { deps_ready[i] = false; break; }
+        }
+    }
+    for (int i = 0; tm->pressure.active && i < tm->num_processes; i++) {
+        Process *proc = &tm->processes[i];
+        int c = proc->config - tm->configs;
+        if (proc->start_pending && proc->pid <= 0 && deps_ready[c] && proc->config->priority < best_waiting) {
+            best_waiting = proc->config->priority;
+        }
+    }
+
+    for (int i = 0; i < tm->num_processes; i++) {
+        Process *proc = &tm->processes[i];
+        ProgramConfig *cfg = proc->config;
+        int c = cfg - tm->configs;
+
+        if (proc->start_pending) {
+            if (!deps_ready[c] || tm->shutting_down || proc->pid > 0) continue;
+            if (!pressure_admit(tm, cfg, best_waiting)) {
+                defer_start(tm, proc);
+                continue;
+            }
+            if (cfg->num_dep_index > 0 && !announced[c]) {
+                log_event("Dependencies of %s are running, starting wave %d", cfg->name, cfg->wave);
+                announced[c] = true;
+            }
+            proc->start_pending = false;
+            start_process(proc);
+            changed++;
+        } else if (proc->stop_pending) {
+            bool clear = true;
+            for (int k = 0; k < tm->num_configs; k++) {
+                if (alive[k] && depends_on_config(&tm->configs[k], c)) { clear = false; break; }
+            }
+            if (!clear) continue;
+            stop_process(proc);
+            changed++;
+        }
+    }
+    return changed + stop_retired(tm);
+}
+
+// Boot and reload convergence: done once nothing is STARTING. Pending starts
+// left at that point wait on dependencies that cannot come up on their own.
+// Instances restarted by their restart policy since convergence began are
+// not waited for, so a flapping program cannot hold it back forever.
+static void check_convergence(Taskmaster *tm) {
+    if (!tm->converging) return;
+
+    int running = 0, blocked = 0, deferred = 0;
+    for (int i = 0; i < tm->num_processes; i++) {
+        Process *proc = &tm->processes[i];
+        bool restarted = proc->restart_us >= tm->converge_start_us;
+        if (proc->state == STATE_STARTING && !restarted) return;
+        if (proc->deferred) deferred++;
+        else if (proc->start_pending) blocked++;
+        if (proc->state == STATE_RUNNING) running++;
+    }
+
+    tm->converging = false;
+    uint64_t elapsed = monotonic_us() - tm->converge_start_us;
+    log_event("Converged in %llu.%03llu s: %d instances running, %d waiting on unavailable dependencies, %d deferred by pressure",
+              (unsigned long long)(elapsed / 1000000), (unsigned long long)(elapsed / 1000 % 1000),
+              running, blocked, deferred);
+}
+
 void update_processes(Taskmaster *tm) {
     int status;
     pid_t pid;
-    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
-        for (int i = 0; i < tm->num_processes; i++) {
-            if (tm->processes[i].pid == pid) {
-                Process *proc = &tm->processes[i];
-                proc->pid = 0;
-                proc->stop_time = time(NULL);
-                
-                bool expected = false;
-                if (WIFEXITED(status)) {
-                    int code = WEXITSTATUS(status);
-                    for (int j = 0; j < proc->config->num_exitcodes; j++) {
-                        if (proc->config->exitcodes[j] == code) { expected = true; break; }
-                    }
-                    if (proc->config->num_exitcodes == 0 && code == 0) expected = true;
-                    log_event("Process %s[%d] exited with code %d (%s)", 
-                        proc->config->name, proc->proc_index, code, expected ? "expected" : "unexpected");
-                } else if (WIFSIGNALED(status)) {
-                    log_event("Process %s[%d] killed by signal %d", proc->config->name, proc->proc_index, WTERMSIG(status));
-                }
+    uint64_t reap_start = monotonic_us();
+    while ((pid = g_backend->reap(&status)) > 0) {
+        Process *proc = find_process_by_pid(tm, pid);
+        if (!proc) continue;
+        pid_index_remove(pid);
+        proc->pid = 0;
+        proc->stop_time = time(NULL);
+        close_output(proc);
+        tm->stats.reaped++;
 
-                if (proc->state == STATE_STOPPING) {
-                    proc->state = STATE_STOPPED;
-                } else {
-                    proc->state = STATE_EXITED;
-                    bool should_restart = false;
-                    if (proc->config->autorestart == RESTART_ALWAYS) should_restart = true;
-                    else if (proc->config->autorestart == RESTART_UNEXPECTED && !expected) should_restart = true;
-
-                    if (should_restart && proc->restart_count < proc->config->startretries) {
-                        proc->restart_count++;
-                        log_event("Restarting process %s[%d] (attempt %d)", proc->config->name, proc->proc_index, proc->restart_count);
-                        start_process(proc);
-                    } else if (should_restart) {
-                        proc->state = STATE_FATAL;
-                        log_event("Process %s[%d] failed to start after %d retries", proc->config->name, proc->proc_index, proc->config->startretries);
-                    }
-                }
-                break;
+        bool expected = false;
+        if (WIFEXITED(status)) {
+            int code = WEXITSTATUS(status);
+            for (int j = 0; j < proc->config->num_exitcodes; j++) {
+                if (proc->config->exitcodes[j] == code) { expected = true; break; }
+            }
+            if (proc->config->num_exitcodes == 0 && code == 0) expected = true;
+            record_event(proc, EVENT_EXIT, code, expected);
+            log_event("Process %s[%d] exited with code %d (%s)", 
+                proc->config->name, proc->proc_index, code, expected ? "expected" : "unexpected");
+        } else if (WIFSIGNALED(status)) {
+            record_event(proc, EVENT_SIGNAL, WTERMSIG(status), false);
+            log_event("Process %s[%d] killed by signal %d", proc->config->name, proc->proc_index, WTERMSIG(status));
+        }
+
+        if (tm->shutting_down && proc->stop_us > 0) {
+            ProgramConfig *cfg = proc->config;
+            uint64_t latency = monotonic_us() - proc->stop_us;
+            cfg->stop_count++;
+            cfg->stop_total_us += latency;
+            if (latency > cfg->stop_max_us) cfg->stop_max_us = latency;
+            if (proc->kill_sent) cfg->stop_killed++;
+        }
+        proc->stop_us = 0;
+
+        if (proc->retired) {
+            close_output(proc);
+            drop_retired(tm, proc);
+            continue;
+        }
+        if (proc->state == STATE_STOPPING || tm->shutting_down) {
+            proc->state = STATE_STOPPED;
+        } else {
+            proc->state = STATE_EXITED;
+            bool should_restart = false;
+            if (proc->config->autorestart == RESTART_ALWAYS) should_restart = true;
+            else if (proc->config->autorestart == RESTART_UNEXPECTED && !expected) should_restart = true;
+
+            if (should_restart && proc->restart_count < proc->config->startretries) {
+                proc->restart_count++;
+                record_event(proc, EVENT_RESTART, proc->restart_count, false);
+                log_event("Restarting process %s[%d] (attempt %d)", proc->config->name, proc->proc_index, proc->restart_count);
+                proc->restart_us = monotonic_us();
+                if (pressure_defers(tm, proc->config)) defer_start(tm, proc);
+                else start_process(proc);
+            } else if (should_restart) {
+                proc->state = STATE_FATAL;
+                record_event(proc, EVENT_FATAL, proc->config->startretries, false);
+                log_event("Process %s[%d] failed to start after %d retries", proc->config->name, proc->proc_index, proc->config->startretries);
             }
         }
     }
+    uint64_t sched_start = monotonic_us();
+    record_timing(&tm->stats.reap, sched_start - reap_start);
 
-    time_t now = time(NULL);
-    for (int i = 0; i < tm->num_processes; i++) {
-        Process *proc = &tm->processes[i];
-        if (proc->state == STATE_STARTING && (now - proc->start_time) >= proc->config->starttime) {
-            proc->state = STATE_RUNNING;
-            proc->restart_count = 0;
+    // Escalate stops that outlived their stoptime, including instances a
+    // reload dropped
+    tm->next_deadline_us = 0;
+    for (int i = 0; i < tm->num_processes + tm->num_retired; i++) {
+        Process *proc = i < tm->num_processes ? &tm->processes[i] : tm->retired[i - tm->num_processes];
+        if (proc->state != STATE_STOPPING || proc->pid <= 0 || proc->kill_sent) continue;
+        if (sched_start >= proc->stop_deadline_us) {
+            log_event("Process %s[%d] did not stop within %d s, sending SIGKILL",
+                      proc->config->name, proc->proc_index, proc->config->stoptime);
+            g_backend->signal(proc->pid, SIGKILL);
+            proc->kill_sent = true;
+        } else if (tm->next_deadline_us == 0 || proc->stop_deadline_us < tm->next_deadline_us) {
+            tm->next_deadline_us = proc->stop_deadline_us;
         }
     }
+
+    // Promotions can unblock the next dependency wave; with a zero starttime
+    // that wave is promoted immediately, so keep going until nothing changes.
+    int changed;
+    do {
+        time_t now = time(NULL);
+        for (int i = 0; i < tm->num_processes; i++) {
+            Process *proc = &tm->processes[i];
+            if (proc->state != STATE_STARTING || (now - proc->start_time) < proc->config->starttime) continue;
+            if (!proc->config->ready_notify) {
+                proc->state = STATE_RUNNING;
+                proc->restart_count = 0;
+                record_event(proc, EVENT_READY, 0, false);
+            } else if (proc->config->starttime > 0 && !proc->ready_timed_out && proc->pid > 0) {
+                // With ready: notify, starttime is only a deadline; the kill is
+                // reaped as a failed start and goes through the restart policy.
+                log_event("Process %s[%d] did not report readiness within %d s, killing it",
+                          proc->config->name, proc->proc_index, proc->config->starttime);
+                proc->ready_timed_out = true;
+                g_backend->signal(proc->pid, SIGKILL);
+            }
+        }
+        changed = run_scheduler(tm);
+    } while (changed > 0);
+
+    check_convergence(tm);
+    record_timing(&tm->stats.scheduler, monotonic_us() - sched_start);
 }
@@ -0,0 +1,287 @@
+#include "taskmaster.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <fnmatch.h>
+
+#define QUERY_OBJECT_MAX 512 // one JSON record, well above the longest name pair
+
+// Open-addressing indexes from program and group names to config indices,
+// rebuilt whenever the config table is replaced. A group slot holds the
+// first member; the rest are chained through next_in_group.
+typedef struct {
+    int *slots; // config index, -1 when free
+    unsigned capacity; // power of two
+} NameIndex;
+
+static NameIndex g_names;
+static NameIndex g_groups;
+
+typedef struct {
+    char name[MAX_NAME_LEN];
+    bool name_glob;
+    char group[MAX_NAME_LEN];
+    int state; // -1 for any
+} QueryFilter;
+
+static unsigned name_hash(const char *name) {
+    unsigned h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) h = (h ^ *p) * 16777619u;
+    return h;
+}
+
+static const char *group_of(const ProgramConfig *cfg) {
+    return cfg->group;
+}
+
+static const char *name_of(const ProgramConfig *cfg) {
+    return cfg->name;
+}
+
+static int index_find(const NameIndex *idx, const Taskmaster *tm, const char *key,
+                      const char *(*key_of)(const ProgramConfig *)) {
+    if (idx->capacity == 0) return -1;
+    for (unsigned i = name_hash(key) & (idx->capacity - 1);; i = (i + 1) & (idx->capacity - 1)) {
+        int c = idx->slots[i];
+        if (c < 0) return -1;
+        if (strcmp(key_of(&tm->configs[c]), key) == 0) return c;
+    }
+}
+
+static bool index_reset(NameIndex *idx, int entries) {
+    unsigned capacity = 16;
+    while (capacity < (unsigned)entries * 2) capacity *= 2;
+    if (capacity != idx->capacity) {
+        int *slots = realloc(idx->slots, sizeof(int) * capacity);
+        if (!slots) return false;
+        idx->slots = slots;
+        idx->capacity = capacity;
+    }
+    memset(idx->slots, 0xff, sizeof(int) * capacity);
+    return true;
+}
+
+static void index_insert(NameIndex *idx, const char *key, int c) {
+    unsigned i = name_hash(key) & (idx->capacity - 1);
+    while (idx->slots[i] >= 0) i = (i + 1) & (idx->capacity - 1);
+    idx->slots[i] = c;
+}
+
+void rebuild_program_index(Taskmaster *tm) {
+    bool ok = index_reset(&g_names, tm->num_configs) && index_reset(&g_groups, tm->num_configs);
+    int base = 0;
+    for (int c = 0; c < tm->num_configs; c++) {
+        ProgramConfig *cfg = &tm->configs[c];
+        cfg->proc_base = base;
+        cfg->next_in_group = -1;
+        base += cfg->numprocs_max;
+        if (!ok) continue;
+        if (index_find(&g_names, tm, cfg->name, name_of) < 0) index_insert(&g_names, cfg->name, c);
+        if (cfg->group[0] == '\0') continue;
+        int first = index_find(&g_groups, tm, cfg->group, group_of);
+        if (first < 0) {
+            index_insert(&g_groups, cfg->group, c);
+            continue;
+        }
+        // Keep members in config order
+        while (tm->configs[first].next_in_group >= 0) first = tm->configs[first].next_in_group;
+        tm->configs[first].next_in_group = c;
+    }
+    if (!ok) {
+        log_event("Query index unavailable: memory allocation failure");
+        g_names.capacity = g_groups.capacity = 0;
+    }
+}
+
+// Filters are space separated: name=PATTERN (a glob when it has * ? or [),
+// group=NAME and state=STATE. A bare word is a name.
+static bool parse_filter(const char *spec, QueryFilter *f, char *err, size_t len) {
+    char buf[MAX_NAME_LEN];
+    strncpy(buf, spec, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    memset(f, 0, sizeof(*f));
+    f->state = -1;
+
+    char *saveptr;
+    for (char *tok = strtok_r(buf, " ", &saveptr); tok; tok = strtok_r(NULL, " ", &saveptr)) {
+        char *eq = strchr(tok, '=');
+        const char *key = eq ? tok : "name";
+        const char *val = eq ? eq + 1 : tok;
+        if (eq) *eq = '\0';
+        if (strcmp(key, "name") == 0) {
+            strncpy(f->name, val, sizeof(f->name) - 1);
+            f->name_glob = strpbrk(val, "*?[") != NULL;
+        } else if (strcmp(key, "group") == 0) {
+            strncpy(f->group, val, sizeof(f->group) - 1);
+        } else if (strcmp(key, "state") == 0) {
+            for (int s = STATE_STOPPED; s <= STATE_STOPPING; s++) {
+                if (strcasecmp(val, state_to_string(s)) == 0) f->state = s;
+            }
+            if (f->state < 0) {
+                snprintf(err, len, "Unknown state: %s\n", val);
+                return false;
+            }
+        } else {
+            snprintf(err, len, "Unknown filter: %s\n", key);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool program_matches(const ProgramConfig *cfg, const QueryFilter *f) {
+    if (f->name[0] && (f->name_glob ? fnmatch(f->name, cfg->name, 0) != 0 : strcmp(f->name, cfg->name) != 0)) return false;
+    if (f->group[0] && strcmp(f->group, cfg->group) != 0) return false;
+    return true;
+}
+
+static void fill_entry(const Process *p, time_t now, QueryEntry *e) {
+    memset(e, 0, sizeof(*e));
+    snprintf(e->name, sizeof(e->name), "%s", p->config->name);
+    snprintf(e->group, sizeof(e->group), "%s", p->config->group);
+    e->state_code = p->state;
+    e->index = p->proc_index;
+    e->pid = p->pid;
+    e->restart_count = p->restart_count;
+    e->start_time = p->start_time;
+    e->stop_time = p->stop_time;
+    if (p->pid > 0 && now > p->start_time) e->uptime = now - p->start_time;
+    if (p->start_pending) e->flags |= BOARD_PENDING;
+    if (p->deferred) e->flags |= BOARD_DEFERRED;
+
+    for (int k = 0; k < p->history_count; k++) {
+        const ProcessEvent *ev = &p->history[(p->history_next - 1 - k + HISTORY_LEN) % HISTORY_LEN];
+        if (ev->type != EVENT_EXIT && ev->type != EVENT_SIGNAL) continue;
+        e->last_exit_kind = ev->type == EVENT_EXIT ? QUERY_EXIT_CODE : QUERY_EXIT_SIGNAL;
+        e->last_exit = ev->value;
+        e->expected = ev->expected;
+        break;
+    }
+}
+
+static size_t json_string(char *buf, size_t len, const char *str) {
+    size_t used = 0;
+    if (used < len) buf[used++] = '"';
+    for (const unsigned char *p = (const unsigned char *)str; *p && used + 7 < len; p++) {
+        if (*p == '"' || *p == '\\') {
+            buf[used++] = '\\';
+            buf[used++] = *p;
+        } else if (*p < 0x20) {
+            used += snprintf(buf + used, len - used, "\\u%04x", *p);
+        } else {
+            buf[used++] = *p;
+        }
+    }
+    if (used < len) buf[used++] = '"';
+    return used;
+}
+
+static size_t format_entry_json(const QueryEntry *e, char *buf, size_t len) {
+    size_t used = snprintf(buf, len, "{\"name\":");
+    used += json_string(buf + used, len - used, e->name);
+    used += snprintf(buf + used, len - used, ",\"group\":");
+    used += json_string(buf + used, len - used, e->group);
+    used += snprintf(buf + used, len - used,
+                     ",\"index\":%d,\"state\":\"%s\",\"pid\":%d,\"uptime\":%lld,\"restarts\":%d,\"last_exit\":",
+                     e->index, state_to_string(e->state_code), e->pid, (long long)e->uptime, e->restart_count);
+    if (e->last_exit_kind == QUERY_EXIT_CODE)
+        used += snprintf(buf + used, len - used, "{\"code\":%d,\"expected\":%s}}", e->last_exit, e->expected ? "true" : "false");
+    else if (e->last_exit_kind == QUERY_EXIT_SIGNAL)
+        used += snprintf(buf + used, len - used, "{\"signal\":%d}}", e->last_exit);
+    else
+        used += snprintf(buf + used, len - used, "null}");
+    return used;
+}
+
+typedef struct {
+    Taskmaster *tm;
+    int fd;
+    bool binary;
+    TMResponse res;
+    size_t used;
+    bool ok;
+} QueryReply;
+
+static void flush_frame(QueryReply *r, bool more) {
+    r->res.more = more;
+    if (r->binary) r->res.length = r->used;
+    else r->res.response[r->used] = '\0';
+    if (!queue_response(r->tm, r->fd, &r->res)) r->ok = false;
+    memset(r->res.response, 0, r->used);
+    r->used = 0;
+}
+
+// JSON frames carry comma separated objects that the client joins into one
+// array; binary frames carry whole QueryEntry records.
+static void emit(QueryReply *r, const Process *p, time_t now) {
+    QueryEntry e;
+    fill_entry(p, now, &e);
+    if (r->binary) {
+        if (r->used + sizeof(e) > MAX_MSG_LEN) flush_frame(r, true);
+        memcpy(r->res.response + r->used, &e, sizeof(e));
+        r->used += sizeof(e);
+        return;
+    }
+    char obj[QUERY_OBJECT_MAX];
+    size_t len = format_entry_json(&e, obj, sizeof(obj));
+    if (r->used + len + 2 > MAX_MSG_LEN) flush_frame(r, true);
+    if (r->used > 0) r->res.response[r->used++] = ',';
+    memcpy(r->res.response + r->used, obj, len);
+    r->used += len;
+}
+
+static void emit_program(QueryReply *r, const ProgramConfig *cfg, const QueryFilter *f, time_t now) {
+    if (!program_matches(cfg, f)) return;
+    for (int i = 0; i < cfg->numprocs_max; i++) {
+        const Process *p = &r->tm->processes[cfg->proc_base + i];
+        // Parked autoscaling slots are not part of the instance set
+        if (p->proc_index >= cfg->active_procs && p->state == STATE_STOPPED) continue;
+        if (f->state >= 0 && (int)p->state != f->state) continue;
+        emit(r, p, now);
+    }
+}
+
+// Answers a query with one or more queued frames. An exact name or a group is
+// resolved through the index; only globs and state-only queries walk the
+// program list, and only the matching programs' slots are visited.
+bool run_query(Taskmaster *tm, int client_fd, const TMRequest *req) {
+    uint64_t query_start = monotonic_us();
+    QueryReply *r = calloc(1, sizeof(QueryReply));
+    if (!r) return false;
+    r->tm = tm;
+    r->fd = client_fd;
+    r->binary = req->flags & REQ_BINARY;
+    r->res.id = req->id;
+    r->res.success = true;
+    r->ok = true;
+
+    QueryFilter f;
+    if (!parse_filter(req->payload, &f, r->res.response, MAX_MSG_LEN)) {
+        r->res.success = false;
+        r->binary = false;
+        r->used = strlen(r->res.response);
+        flush_frame(r, false);
+        bool ok = r->ok;
+        free(r);
+        return ok;
+    }
+
+    time_t now = time(NULL);
+    bool indexed = g_names.capacity > 0;
+    if (f.name[0] && !f.name_glob && indexed) {
+        int c = index_find(&g_names, tm, f.name, name_of);
+        if (c >= 0) emit_program(r, &tm->configs[c], &f, now);
+    } else if (f.group[0] && indexed) {
+        for (int c = index_find(&g_groups, tm, f.group, group_of); c >= 0; c = tm->configs[c].next_in_group)
+            emit_program(r, &tm->configs[c], &f, now);
+    } else {
+        for (int c = 0; c < tm->num_configs; c++) emit_program(r, &tm->configs[c], &f, now);
+    }
+    flush_frame(r, false);
+
+    bool ok = r->ok;
+    free(r);
+    record_timing(&tm->stats.query, monotonic_us() - query_start);
+    return ok;
+}
@@ -0,0 +1,213 @@
+#include "taskmaster.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <sys/wait.h>
+
+// Simulated pids start above the kernel's pid_max limit so they can never
+// be mistaken for real processes.
+#define SIM_PID_BASE 10000000
+#define SIM_NO_EXIT UINT64_MAX
+
+typedef struct {
+    unsigned spawn_us;   // cost charged to the daemon for every spawn
+    double exit_rate;    // random exits per instance per second
+    int exit_code;       // code used for random exits
+    unsigned stop_ms;    // delay between a stop signal and the exit
+    double ignore_rate;  // share of instances ignoring their stopsignal
+    long seed;
+} SimParams;
+
+typedef struct {
+    bool alive;
+    bool ignores_stop;
+    uint64_t exit_us;
+    int status;
+} SimProc;
+
+typedef struct {
+    uint64_t when;
+    int slot;
+} SimEvent;
+
+static SimParams g_params = { 0, 0.0, 1, 10, 0.0, 1 };
+
+static SimProc *g_procs;
+static int g_capacity;
+static int *g_free;
+static int g_num_free;
+static int g_num_alive;
+
+// Min-heap of pending exits. Entries made stale by a signal are skipped
+// when popped and purged when they outnumber live instances.
+static SimEvent *g_heap;
+static int g_heap_len;
+static int g_heap_cap;
+
+bool configure_simulation(const char *spec) {
+    char buf[MAX_CMD_LEN];
+    strncpy(buf, spec ? spec : "", sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    char *saveptr;
+    for (char *opt = strtok_r(buf, ",", &saveptr); opt; opt = strtok_r(NULL, ",", &saveptr)) {
+        char *eq = strchr(opt, '=');
+        if (!eq) return false;
+        *eq = '\0';
+        const char *val = eq + 1;
+        if (strcmp(opt, "spawn_us") == 0) g_params.spawn_us = atoi(val);
+        else if (strcmp(opt, "exit_rate") == 0) g_params.exit_rate = atof(val);
+        else if (strcmp(opt, "exit_code") == 0) g_params.exit_code = atoi(val);
+        else if (strcmp(opt, "stop_ms") == 0) g_params.stop_ms = atoi(val);
+        else if (strcmp(opt, "ignore_rate") == 0) g_params.ignore_rate = atof(val);
+        else if (strcmp(opt, "seed") == 0) g_params.seed = atol(val);
+        else return false;
+    }
+    srand48(g_params.seed);
+    return true;
+}
+
+static void heap_push(uint64_t when, int slot);
+
+static void heap_purge(void) {
+    g_heap_len = 0;
+    for (int i = 0; i < g_capacity; i++) {
+        if (g_procs[i].alive && g_procs[i].exit_us != SIM_NO_EXIT) heap_push(g_procs[i].exit_us, i);
+    }
+}
+
+static void heap_push(uint64_t when, int slot) {
+    if (g_heap_len == g_heap_cap) {
+        if (g_heap_len > 2 * g_num_alive + 64) {
+            heap_purge();
+        } else {
+            int cap = g_heap_cap ? g_heap_cap * 2 : 256;
+            SimEvent *grown = realloc(g_heap, sizeof(SimEvent) * cap);
+            if (!grown) return;
+            g_heap = grown;
+            g_heap_cap = cap;
+        }
+    }
+    int i = g_heap_len++;
+    while (i > 0 && g_heap[(i - 1) / 2].when > when) {
+        g_heap[i] = g_heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    g_heap[i].when = when;
+    g_heap[i].slot = slot;
+}
+
+static SimEvent heap_pop(void) {
+    SimEvent top = g_heap[0];
+    SimEvent last = g_heap[--g_heap_len];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= g_heap_len) break;
+        if (child + 1 < g_heap_len && g_heap[child + 1].when < g_heap[child].when) child++;
+        if (g_heap[child].when >= last.when) break;
+        g_heap[i] = g_heap[child];
+        i = child;
+    }
+    if (g_heap_len > 0) g_heap[i] = last;
+    return top;
+}
+
+static int alloc_slot(void) {
+    if (g_num_free == 0) {
+        int cap = g_capacity ? g_capacity * 2 : 1024;
+        SimProc *procs = realloc(g_procs, sizeof(SimProc) * cap);
+        if (!procs) return -1;
+        int *free_slots = realloc(g_free, sizeof(int) * cap);
+        if (!free_slots) {
+            g_procs = procs;
+            return -1;
+        }
+        g_procs = procs;
+        g_free = free_slots;
+        memset(&g_procs[g_capacity], 0, sizeof(SimProc) * (cap - g_capacity));
+        for (int i = cap - 1; i >= g_capacity; i--) g_free[g_num_free++] = i;
+        g_capacity = cap;
+    }
+    return g_free[--g_num_free];
+}
+
+static SimProc *lookup(pid_t pid) {
+    int slot = pid - SIM_PID_BASE;
+    if (slot < 0 || slot >= g_capacity || !g_procs[slot].alive) return NULL;
+    return &g_procs[slot];
+}
+
+static pid_t sim_spawn(Process *proc) {
+    (void)proc;
+    if (g_params.spawn_us > 0) {
+        uint64_t until = monotonic_us() + g_params.spawn_us;
+        while (monotonic_us() < until) {}
+    }
+
+    int slot = alloc_slot();
+    if (slot < 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    SimProc *sp = &g_procs[slot];
+    sp->alive = true;
+    sp->ignores_stop = drand48() < g_params.ignore_rate;
+    sp->exit_us = SIM_NO_EXIT;
+    if (g_params.exit_rate > 0) {
+        // Exponentially distributed lifetime for a constant exit rate
+        double lifetime = -log(1.0 - drand48()) / g_params.exit_rate;
+        sp->exit_us = monotonic_us() + (uint64_t)(lifetime * 1e6);
+        sp->status = W_EXITCODE(g_params.exit_code, 0);
+        heap_push(sp->exit_us, slot);
+    }
+    g_num_alive++;
+    return SIM_PID_BASE + slot;
+}
+
+static int sim_signal(pid_t pid, int sig) {
+    SimProc *sp = lookup(pid);
+    if (!sp) {
+        errno = ESRCH;
+        return -1;
+    }
+    if (sig == 0 || (sp->ignores_stop && sig != SIGKILL)) return 0;
+
+    uint64_t when = monotonic_us() + (sig == SIGKILL ? 0 : g_params.stop_ms * 1000ULL);
+    if (when < sp->exit_us) {
+        sp->exit_us = when;
+        sp->status = W_EXITCODE(0, sig);
+        heap_push(when, pid - SIM_PID_BASE);
+    }
+    return 0;
+}
+
+// Like waitpid, one reaping pass only sees exits that were due when it
+// began; instances restarted during the pass are left for the next one.
+static pid_t sim_reap(int *status) {
+    static uint64_t pass_until;
+    if (pass_until == 0) pass_until = monotonic_us();
+    while (g_heap_len > 0 && g_heap[0].when <= pass_until) {
+        SimEvent ev = heap_pop();
+        SimProc *sp = &g_procs[ev.slot];
+        if (!sp->alive || sp->exit_us != ev.when) continue;
+        sp->alive = false;
+        g_num_alive--;
+        g_free[g_num_free++] = ev.slot;
+        *status = sp->status;
+        return SIM_PID_BASE + ev.slot;
+    }
+    pass_until = 0;
+    return 0;
+}
+
+// Simulated exits send no SIGCHLD, so the daemon sleeps until the heap top.
+// A stale top only wakes it early.
+static uint64_t sim_next_exit_us(void) {
+    return g_heap_len > 0 ? g_heap[0].when : 0;
+}
+
+const ProcessBackend sim_backend = { "sim", sim_spawn, sim_signal, sim_reap, sim_next_exit_us };
@@ -0,0 +1,124 @@
+#include "taskmaster.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+static size_t board_bytes(int capacity) {
+    return sizeof(StatusBoard) + sizeof(BoardEntry) * capacity;
+}
+
+// Maps the board with room for every process slot, growing the segment
+// when a reload added slots.
+static bool map_board(Taskmaster *tm, int fd) {
+    int capacity = tm->num_processes > 0 ? tm->num_processes : 1;
+    size_t size = board_bytes(capacity);
+    if (ftruncate(fd, size) != 0) return false;
+
+    StatusBoard *board = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (board == MAP_FAILED) return false;
+    BoardEntry *shadow = calloc(capacity, sizeof(BoardEntry));
+    if (!shadow) {
+        munmap(board, size);
+        return false;
+    }
+
+    if (tm->board) munmap(tm->board, tm->board_size);
+    free(tm->board_shadow);
+    tm->board = board;
+    tm->board_size = size;
+    tm->board_shadow = shadow;
+
+    board->magic = STATUS_BOARD_MAGIC;
+    board->version = STATUS_BOARD_VERSION;
+    board->daemon_pid = getpid();
+    __atomic_store_n(&board->capacity, capacity, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool open_status_board(Taskmaster *tm) {
+    // A board left by a crashed daemon may still be mapped by readers, so it
+    // is unlinked rather than truncated; they keep the stale copy and see
+    // its daemon_pid and heartbeat
+    shm_unlink(STATUS_BOARD_NAME);
+    int fd = shm_open(STATUS_BOARD_NAME, O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        log_event("Status board unavailable: shm_open failed");
+        return false;
+    }
+    bool ok = map_board(tm, fd);
+    close(fd);
+    if (!ok) {
+        log_event("Status board unavailable: cannot map %s", STATUS_BOARD_NAME);
+        shm_unlink(STATUS_BOARD_NAME);
+        return false;
+    }
+    publish_status_board(tm);
+    return true;
+}
+
+static void fill_entry(const Process *p, BoardEntry *e) {
+    memset(e, 0, sizeof(*e));
+    snprintf(e->name, sizeof(e->name), "%s", p->config->name);
+    snprintf(e->state, sizeof(e->state), "%s", state_to_string(p->state));
+    e->state_code = p->state;
+    e->index = p->proc_index;
+    e->pid = p->pid;
+    e->restart_count = p->restart_count;
+    e->start_time = p->start_time;
+    e->stop_time = p->stop_time;
+    if (p->proc_index >= p->config->active_procs && p->state == STATE_STOPPED) e->flags |= BOARD_PARKED;
+    if (p->start_pending) e->flags |= BOARD_PENDING;
+    if (p->deferred) e->flags |= BOARD_DEFERRED;
+}
+
+// Called once per loop iteration. Entries are diffed against the last
+// publish so the seqlock write section, and reader retries, only happen
+// when something actually changed.
+void publish_status_board(Taskmaster *tm) {
+    if (!tm->board) return;
+
+    if ((uint32_t)tm->num_processes > tm->board->capacity) {
+        int fd = shm_open(STATUS_BOARD_NAME, O_RDWR | O_CLOEXEC, 0);
+        bool ok = fd >= 0 && map_board(tm, fd);
+        if (fd >= 0) close(fd);
+        if (!ok) {
+            log_event("Status board disabled: cannot grow to %d entries", tm->num_processes);
+            close_status_board(tm);
+            return;
+        }
+    }
+
+    StatusBoard *board = tm->board;
+    bool changed = board->num_entries != (uint32_t)tm->num_processes;
+    for (int i = 0; i < tm->num_processes; i++) {
+        BoardEntry e;
+        fill_entry(&tm->processes[i], &e);
+        if (memcmp(&e, &tm->board_shadow[i], sizeof(e)) != 0) {
+            tm->board_shadow[i] = e;
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        uint32_t seq = board->seq;
+        __atomic_store_n(&board->seq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        memcpy(board->entries, tm->board_shadow, sizeof(BoardEntry) * tm->num_processes);
+        board->num_entries = tm->num_processes;
+        __atomic_store_n(&board->seq, seq + 2, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&board->heartbeat, (int64_t)time(NULL), __ATOMIC_RELAXED);
+}
+
+void close_status_board(Taskmaster *tm) {
+    if (!tm->board) return;
+    munmap(tm->board, tm->board_size);
+    free(tm->board_shadow);
+    tm->board = NULL;
+    tm->board_shadow = NULL;
+    tm->board_size = 0;
+    shm_unlink(STATUS_BOARD_NAME);
+}
@@ -8,6 +8,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <sys/time.h>
 
 Taskmaster g_tm;
 char *g_config_path = NULL;
@@ -18,6 +19,34 @@ void handle_sighup(int sig) {
     g_reload_requested = 1;
 }
 
+// Self-pipe so an exiting child wakes select() and is reaped right away
+static int g_sigchld_pipe[2] = {-1, -1};
+
+static void handle_sigchld(int sig) {
+    (void)sig;
+    int saved = errno;
+    if (write(g_sigchld_pipe[1], "x", 1) < 0) {}
+    errno = saved;
+}
+
+static void setup_sigchld(void) {
+    if (pipe2(g_sigchld_pipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+        perror("pipe2");
+        exit(1);
+    }
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_sigchld;
+    sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGCHLD, &sa, NULL);
+}
+
+static void drain_sigchld(void) {
+    char buf[64];
+    while (read(g_sigchld_pipe[0], buf, sizeof(buf)) > 0) {}
+}
+
 static void setup_server_socket(Taskmaster *tm) {
     tm->server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
     if (tm->server_fd < 0) {
@@ -44,17 +73,325 @@ static void setup_server_socket(Taskmaster *tm) {
     fcntl(tm->server_fd, F_SETFL, O_NONBLOCK);
 }
 
-void handle_client(Taskmaster *tm, int client_fd) {
-    TMRequest req;
+// Datagram socket for sd_notify-style readiness messages from children.
+static void setup_notify_socket(Taskmaster *tm) {
+    tm->notify_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (tm->notify_fd < 0) {
+        perror("socket");
+        exit(1);
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, NOTIFY_SOCKET_PATH, sizeof(addr.sun_path) - 1);
+
+    unlink(NOTIFY_SOCKET_PATH);
+    if (bind(tm->notify_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        exit(1);
+    }
+    // Children may run as another user
+    chmod(NOTIFY_SOCKET_PATH, 0666);
+
+    int on = 1;
+    setsockopt(tm->notify_fd, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on));
+    setsockopt(tm->notify_fd, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on));
+}
+
+static pid_t parent_pid_of(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+
+    // The command name may contain spaces; fields resume after the last ')'
+    char buf[512];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    char *p = strrchr(buf, ')');
+    int ppid = 0;
+    if (!p || sscanf(p + 1, " %*c %d", &ppid) != 1) return 0;
+    return ppid;
+}
+
+static void handle_notify(Taskmaster *tm) {
+    char buf[MAX_CMD_LEN];
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(struct ucred)) + CMSG_SPACE(sizeof(struct timeval))];
+    } control;
+
+    for (;;) {
+        struct iovec iov = { buf, sizeof(buf) - 1 };
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+
+        ssize_t n = recvmsg(tm->notify_fd, &msg, MSG_DONTWAIT);
+        if (n < 0) return;
+        buf[n] = '\0';
+
+        struct ucred *cred = NULL;
+        struct timeval *stamp = NULL;
+        for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level != SOL_SOCKET) continue;
+            if (c->cmsg_type == SCM_CREDENTIALS) cred = (struct ucred *)CMSG_DATA(c);
+            else if (c->cmsg_type == SCM_TIMESTAMP) stamp = (struct timeval *)CMSG_DATA(c);
+        }
+        if (!cred) continue;
+
+        // Helpers such as systemd-notify send on behalf of their parent
+        Process *proc = find_process_by_pid(tm, cred->pid);
+        if (!proc) proc = find_process_by_pid(tm, parent_pid_of(cred->pid));
+        if (!proc || !proc->config->ready_notify) continue;
+
+        uint64_t latency_us = 0;
+        if (stamp) {
+            struct timeval now;
+            gettimeofday(&now, NULL);
+            latency_us = (uint64_t)(now.tv_sec - stamp->tv_sec) * 1000000 + (now.tv_usec - stamp->tv_usec);
+        }
+
+        char *saveptr;
+        for (char *line = strtok_r(buf, "\n", &saveptr); line; line = strtok_r(NULL, "\n", &saveptr)) {
+            if (strcmp(line, "READY=1") == 0) {
+                mark_ready(proc, latency_us);
+            } else if (strncmp(line, "STATUS=", 7) == 0) {
+                strncpy(proc->notify_status, line + 7, sizeof(proc->notify_status) - 1);
+                proc->notify_status[sizeof(proc->notify_status) - 1] = '\0';
+            }
+        }
+    }
+}
+
+static void close_client(Taskmaster *tm, int slot) {
+    ClientConn *c = &tm->clients[slot];
+    if (c->fd == tm->shutdown_client) tm->shutdown_client = -1;
+    close(c->fd);
+    free(c->out);
+    tm->clients[slot] = tm->clients[--tm->num_clients];
+}
+
+// Connections stay open between commands, so a full table makes room by
+// closing the one that went longest without activity. The connection
+// waiting for the shutdown report is kept.
+static bool evict_idle_client(Taskmaster *tm) {
+    int oldest = -1;
+    for (int i = 0; i < tm->num_clients; i++) {
+        if (tm->clients[i].fd == tm->shutdown_client) continue;
+        if (oldest < 0 || tm->clients[i].active_us < tm->clients[oldest].active_us) oldest = i;
+    }
+    if (oldest < 0) return false;
+    log_event("Closing idle client connection to accept a new one");
+    close_client(tm, oldest);
+    return true;
+}
+
+static void accept_client(Taskmaster *tm) {
+    int client_fd = accept4(tm->server_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (client_fd < 0) return;
+    if (client_fd >= FD_SETSIZE || (tm->num_clients >= MAX_CLIENTS && !evict_idle_client(tm))) {
+        log_event("Rejecting client: too many open connections");
+        close(client_fd);
+        return;
+    }
+    ClientConn *c = &tm->clients[tm->num_clients++];
+    memset(c, 0, sizeof(*c));
+    c->fd = client_fd;
+    c->active_us = monotonic_us();
+}
+
+static size_t queued_bytes(const ClientConn *c) {
+    return c->out_len - c->out_sent;
+}
+
+// Writes as much queued output as the socket takes. Returns false once the
+// peer is gone.
+static bool flush_client(ClientConn *c) {
+    while (c->out_sent < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_sent, c->out_len - c->out_sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+        c->out_sent += n;
+        c->active_us = monotonic_us();
+    }
+    c->out_len = c->out_sent = 0;
+    return true;
+}
+
+bool queue_response(Taskmaster *tm, int client_fd, const TMResponse *res) {
+    ClientConn *c = NULL;
+    for (int i = 0; i < tm->num_clients; i++) {
+        if (tm->clients[i].fd == client_fd) c = &tm->clients[i];
+    }
+    if (!c) return false;
+
+    // Only the used part of the response goes out
+    uint32_t length = res->length ? res->length : strnlen(res->response, MAX_MSG_LEN - 1);
+    size_t frame = TM_RESPONSE_HEADER + length;
+
+    if (c->out_sent > 0 && c->out_len + frame > c->out_cap) {
+        memmove(c->out, c->out + c->out_sent, queued_bytes(c));
+        c->out_len -= c->out_sent;
+        c->out_sent = 0;
+    }
+    if (c->out_len + frame > c->out_cap) {
+        size_t cap = c->out_cap ? c->out_cap * 2 : 4 * sizeof(*res);
+        while (cap < c->out_len + frame) cap *= 2;
+        char *out = realloc(c->out, cap);
+        if (!out) return false;
+        c->out = out;
+        c->out_cap = cap;
+    }
+    memcpy(c->out + c->out_len, res, TM_RESPONSE_HEADER);
+    memcpy(c->out + c->out_len + offsetof(TMResponse, length), &length, sizeof(length));
+    memcpy(c->out + c->out_len + TM_RESPONSE_HEADER, res->response, length);
+    c->out_len += frame;
+    return flush_client(c);
+}
+
+// Assembles requests from whatever has arrived and serves each complete one.
+// Reading pauses while the client has more than CLIENT_QUEUE_MAX of replies
+// it has not read. Returns false once the connection should be closed.
+static bool read_client(Taskmaster *tm, ClientConn *c) {
+    while (queued_bytes(c) < CLIENT_QUEUE_MAX) {
+        ssize_t n = recv(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len, 0);
+        if (n == 0) return false;
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        c->in_len += n;
+        c->active_us = monotonic_us();
+        if (c->in_len < sizeof(c->in)) continue;
+
+        TMRequest req;
+        memcpy(&req, c->in, sizeof(req));
+        c->in_len = 0;
+        if (!handle_client(tm, c->fd, &req)) return false;
+        if (!tm->running) break;
+    }
+    return true;
+}
+
+// On exit, gives every client a moment to take its remaining replies
+static void drain_clients(Taskmaster *tm) {
+    struct timeval timeout = {1, 0};
+    for (int i = 0; i < tm->num_clients; i++) {
+        ClientConn *c = &tm->clients[i];
+        if (queued_bytes(c) == 0) continue;
+        fcntl(c->fd, F_SETFL, 0);
+        setsockopt(c->fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        flush_client(c);
+    }
+}
+
+static void describe_event(const ProcessEvent *ev, char *buf, size_t len) {
+    switch (ev->type) {
+        case EVENT_START: snprintf(buf, len, "pid %d", ev->value); break;
+        case EVENT_EXIT:
+            snprintf(buf, len, "code %d (%s) after %d ms", ev->value,
+                     ev->expected ? "expected" : "unexpected", ev->runtime_ms);
+            break;
+        case EVENT_SIGNAL: snprintf(buf, len, "signal %d after %d ms", ev->value, ev->runtime_ms); break;
+        case EVENT_RESTART: snprintf(buf, len, "attempt %d", ev->value); break;
+        case EVENT_STOP: snprintf(buf, len, "signal %d", ev->value); break;
+        case EVENT_FATAL: snprintf(buf, len, "gave up after %d retries", ev->value); break;
+        default: buf[0] = '\0';
+    }
+}
+
+// Lists the event ring of every instance of a program, oldest first.
+static void format_history(Taskmaster *tm, const char *name, TMResponse *res) {
+    size_t used = snprintf(res->response, MAX_MSG_LEN, "%-20s %-6s %-20s %-8s %s\n",
+                           "NAME", "INDEX", "TIME", "EVENT", "DETAIL");
+    bool found = false;
+
+    for (int i = 0; i < tm->num_processes && used < MAX_MSG_LEN; i++) {
+        Process *p = &tm->processes[i];
+        if (strcmp(p->config->name, name) != 0) continue;
+        found = true;
+        int first = (p->history_next - p->history_count + HISTORY_LEN) % HISTORY_LEN;
+        for (int e = 0; e < p->history_count && used < MAX_MSG_LEN; e++) {
+            const ProcessEvent *ev = &p->history[(first + e) % HISTORY_LEN];
+            char when[32], detail[MAX_NAME_LEN];
+            strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&ev->time));
+            describe_event(ev, detail, sizeof(detail));
+            used += snprintf(res->response + used, MAX_MSG_LEN - used, "%-20s %-6d %-20s %-8s %s\n",
+                             name, p->proc_index, when, event_to_string(ev->type), detail);
+        }
+    }
+
+    if (!found) {
+        res->success = false;
+        snprintf(res->response, MAX_MSG_LEN, "No such program: %s\n", name);
+    }
+}
+
+// Payload is "<name> <count>"; the count is clamped to the program's bounds.
+static void handle_scale(Taskmaster *tm, const char *payload, TMResponse *res) {
+    char name[MAX_NAME_LEN];
+    int target;
+    if (sscanf(payload, "%63s %d", name, &target) != 2) {
+        res->success = false;
+        snprintf(res->response, MAX_MSG_LEN, "Usage: scale <name> <count>\n");
+        return;
+    }
+    for (int i = 0; i < tm->num_configs; i++) {
+        ProgramConfig *cfg = &tm->configs[i];
+        if (strcmp(cfg->name, name) != 0) continue;
+        log_event("Client requested scale: %s to %d", name, target);
+        int applied = scale_program(tm, cfg, target, "scale command");
+        snprintf(res->response, MAX_MSG_LEN, "Scaled %s to %d instances (bounds %d-%d)\n",
+                 name, applied, cfg->numprocs_min, cfg->numprocs_max);
+        return;
+    }
+    res->success = false;
+    snprintf(res->response, MAX_MSG_LEN, "No such program: %s\n", name);
+}
+
+static int format_timing(char *buf, size_t len, const char *label, const Timing *t) {
+    unsigned long long avg = t->count ? t->total_us / t->count : 0;
+    return snprintf(buf, len, "%-10s %10llu calls  avg %8llu us  max %8llu us\n",
+                    label, (unsigned long long)t->count, avg, (unsigned long long)t->max_us);
+}
+
+// Backend in use, table sizes and the cost of the daemon's main operations.
+static void format_stats(Taskmaster *tm, TMResponse *res) {
+    int live = 0;
+    for (int i = 0; i < tm->num_processes; i++) {
+        if (tm->processes[i].pid > 0) live++;
+    }
+
+    char *buf = res->response;
+    size_t used = snprintf(buf, MAX_MSG_LEN, "backend    %s\nslots      %d (%d live)\nreaped     %llu\n",
+                           get_process_backend()->name, tm->num_processes, live,
+                           (unsigned long long)tm->stats.reaped);
+    used += format_timing(buf + used, MAX_MSG_LEN - used, "reap", &tm->stats.reap);
+    used += format_timing(buf + used, MAX_MSG_LEN - used, "scheduler", &tm->stats.scheduler);
+    used += format_timing(buf + used, MAX_MSG_LEN - used, "status", &tm->stats.status);
+    used += format_timing(buf + used, MAX_MSG_LEN - used, "query", &tm->stats.query);
+    format_timing(buf + used, MAX_MSG_LEN - used, "reload", &tm->stats.reload);
+}
+
+// Serves one request from a client connection. Connections stay open so a
+// client can pipeline a batch of commands; returns false once the peer has
+// gone away and the connection should be closed.
+bool handle_client(Taskmaster *tm, int client_fd, const TMRequest *request) {
+    TMRequest req = *request;
     TMResponse res;
     memset(&res, 0, sizeof(res));
     res.success = true;
 
-    if (recv(client_fd, &req, sizeof(req), 0) <= 0) return;
+    req.payload[sizeof(req.payload) - 1] = '\0';
+    res.id = req.id;
 
     switch (req.type) {
         case CMD_STATUS:
             {
+                uint64_t status_start = monotonic_us();
                 char *ptr = res.response;
                 int remaining = MAX_MSG_LEN - 1;
                 int written = snprintf(ptr, remaining, "%-20s %-10s %-10s %-20s\n", "NAME", "INDEX", "STATE", "INFO");
@@ -62,18 +399,34 @@ void handle_client(Taskmaster *tm, int client_fd) {
                 
                 for (int i = 0; i < tm->num_processes; i++) {
                     Process *p = &tm->processes[i];
-                    written = snprintf(ptr, remaining, "%-20s %-10d %-10s pid %d\n", 
-                        p->config->name, p->proc_index, state_to_string(p->state), p->pid);
+                    // Parked autoscaling slots are not part of the instance set
+                    if (p->proc_index >= p->config->active_procs && p->state == STATE_STOPPED) continue;
+                    char placement[MAX_CMD_LEN];
+                    describe_placement(p, placement, sizeof(placement));
+                    written = snprintf(ptr, remaining, "%-20s %-10d %-10s pid %d%s%s%s%s\n",
+                        p->config->name, p->proc_index, state_to_string(p->state), p->pid, placement,
+                        p->notify_status[0] ? " status: " : "", p->notify_status,
+                        p->deferred ? " (deferred by pressure)" :
+                        p->start_pending ? (p->pid > 0 ? " (starting again once stopped)" : " (waiting on dependencies)") : "");
                     ptr += written; remaining -= written;
                     if (remaining <= 0) break;
                 }
+                if (remaining > 0) {
+                    describe_pressure(tm, ptr, remaining);
+                    written = strlen(ptr);
+                    ptr += written; remaining -= written;
+                }
+                if (remaining > 0) describe_output_limits(tm, ptr, remaining);
+                record_timing(&tm->stats.status, monotonic_us() - status_start);
             }
             break;
         case CMD_START:
             log_event("Client requested start: %s", req.payload);
             for (int i = 0; i < tm->num_processes; i++) {
-                if (strcmp(tm->processes[i].config->name, req.payload) == 0) {
-                    start_process(&tm->processes[i]);
+                Process *p = &tm->processes[i];
+                if (p->proc_index >= p->config->active_procs) continue;
+                if (strcmp(req.payload, "all") == 0 || strcmp(p->config->name, req.payload) == 0) {
+                    schedule_start(p);
                 }
             }
             snprintf(res.response, MAX_MSG_LEN, "Started %s\n", req.payload);
@@ -81,83 +434,194 @@ void handle_client(Taskmaster *tm, int client_fd) {
         case CMD_STOP:
             log_event("Client requested stop: %s", req.payload);
             for (int i = 0; i < tm->num_processes; i++) {
-                if (strcmp(tm->processes[i].config->name, req.payload) == 0) {
-                    stop_process(&tm->processes[i]);
-                }
+                // "all" stops dependents before the programs they depend on
+                if (strcmp(req.payload, "all") == 0) schedule_stop(&tm->processes[i]);
+                else if (strcmp(tm->processes[i].config->name, req.payload) == 0) stop_process(&tm->processes[i]);
             }
             snprintf(res.response, MAX_MSG_LEN, "Stopped %s\n", req.payload);
             break;
+        case CMD_HISTORY:
+            format_history(tm, req.payload, &res);
+            break;
+        case CMD_SCALE:
+            handle_scale(tm, req.payload, &res);
+            break;
+        case CMD_STATS:
+            format_stats(tm, &res);
+            break;
+        case CMD_QUERY:
+            // Replied to in as many frames as the result needs
+            return run_query(tm, client_fd, &req);
         case CMD_RELOAD:
             g_reload_requested = 1;
             snprintf(res.response, MAX_MSG_LEN, "Reload requested\n");
             break;
         case CMD_SHUTDOWN:
-            tm->running = false;
-            snprintf(res.response, MAX_MSG_LEN, "Daemon shutting down\n");
-            break;
+            if (tm->shutting_down) {
+                snprintf(res.response, MAX_MSG_LEN, "Shutdown already in progress\n");
+                break;
+            }
+            log_event("Client requested shutdown");
+            if (begin_shutdown(tm) == 0) {
+                tm->running = false;
+                snprintf(res.response, MAX_MSG_LEN, "Daemon shutting down\n");
+                break;
+            }
+            // Answered with the stop latency report once every instance is reaped
+            tm->shutdown_client = client_fd;
+            tm->shutdown_req_id = req.id;
+            return true;
         default:
             res.success = false;
             snprintf(res.response, MAX_MSG_LEN, "Unknown command\n");
     }
 
-    send(client_fd, &res, sizeof(res), 0);
+    return queue_response(tm, client_fd, &res);
 }
 
 int main(int argc, char **argv) {
     openlog("taskmasterd", LOG_PID | LOG_CONS, LOG_DAEMON);
     memset(&g_tm, 0, sizeof(Taskmaster));
+    default_pressure_config(&g_tm.pressure.cfg);
     g_tm.running = true;
 
     signal(SIGHUP, handle_sighup);
-    signal(SIGCHLD, SIG_DFL);
+    setup_sigchld();
+    g_tm.shutdown_client = -1;
 
-    if (argc > 1) g_config_path = strdup(argv[1]);
+    int argi = 1;
+    for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; argi++) {
+        if (strcmp(argv[argi], "--simulate") == 0 || strncmp(argv[argi], "--simulate=", 11) == 0) {
+            const char *spec = argv[argi][10] == '=' ? argv[argi] + 11 : "";
+            if (!configure_simulation(spec)) {
+                fprintf(stderr, "Invalid simulation parameters: %s\n", spec);
+                return 1;
+            }
+            set_process_backend(&sim_backend);
+        } else {
+            fprintf(stderr, "Usage: %s [--simulate[=key=value,...]] [config]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (argi < argc) g_config_path = strdup(argv[argi]);
     else g_config_path = strdup(DEFAULT_CONFIG_DIR);
 
     struct stat st;
     if (stat(g_config_path, &st) == 0 && S_ISDIR(st.st_mode)) parse_config_dir(g_config_path, &g_tm);
     else parse_config(g_config_path, &g_tm);
 
+    if (!resolve_dependencies(&g_tm)) {
+        log_event("Aborting: configuration has a dependency cycle");
+        return 1;
+    }
+
     g_tm.num_processes = 0;
-    for (int i = 0; i < g_tm.num_configs; i++) g_tm.num_processes += g_tm.configs[i].numprocs;
+    for (int i = 0; i < g_tm.num_configs; i++) g_tm.num_processes += g_tm.configs[i].numprocs_max;
     g_tm.processes = calloc(g_tm.num_processes, sizeof(Process));
     int proc_idx = 0;
+    begin_convergence(&g_tm);
     for (int i = 0; i < g_tm.num_configs; i++) {
-        for (int j = 0; j < g_tm.configs[i].numprocs; j++) {
+        for (int j = 0; j < g_tm.configs[i].numprocs_max; j++) {
             g_tm.processes[proc_idx].config = &g_tm.configs[i];
             g_tm.processes[proc_idx].proc_index = j;
-            if (g_tm.configs[i].autostart) start_process(&g_tm.processes[proc_idx]);
+            if (g_tm.configs[i].autostart && j < g_tm.configs[i].active_procs) schedule_start(&g_tm.processes[proc_idx]);
             proc_idx++;
         }
     }
+    rebuild_pid_index(&g_tm);
+    rebuild_program_index(&g_tm);
 
     setup_server_socket(&g_tm);
-    log_event("Daemon started, config: %s", g_config_path);
+    setup_notify_socket(&g_tm);
+    setup_pressure(&g_tm);
+    update_pressure(&g_tm);
+    open_status_board(&g_tm);
+    log_event("Daemon started, config: %s, backend: %s", g_config_path, get_process_backend()->name);
+    update_processes(&g_tm);
+    publish_status_board(&g_tm);
 
     while (g_tm.running) {
-        fd_set readfds;
+        fd_set readfds, writefds, exceptfds;
         FD_ZERO(&readfds);
+        FD_ZERO(&writefds);
+        FD_ZERO(&exceptfds);
         FD_SET(g_tm.server_fd, &readfds);
+        FD_SET(g_tm.notify_fd, &readfds);
+        FD_SET(g_sigchld_pipe[0], &readfds);
+        int max_fd = g_tm.server_fd > g_tm.notify_fd ? g_tm.server_fd : g_tm.notify_fd;
+        if (g_sigchld_pipe[0] > max_fd) max_fd = g_sigchld_pipe[0];
+        for (int i = 0; i < g_tm.num_clients; i++) {
+            ClientConn *c = &g_tm.clients[i];
+            if (queued_bytes(c) < CLIENT_QUEUE_MAX) FD_SET(c->fd, &readfds);
+            if (queued_bytes(c) > 0) FD_SET(c->fd, &writefds);
+            if (c->fd > max_fd) max_fd = c->fd;
+        }
+        max_fd = pressure_fds(&g_tm, &exceptfds, max_fd);
+        max_fd = output_fds(&g_tm, &readfds, max_fd);
 
+        // Wake up in time for the next stoptime escalation or simulated exit
         struct timeval tv = {1, 0};
-        int ret = select(g_tm.server_fd + 1, &readfds, NULL, NULL, &tv);
+        uint64_t wake_us = g_tm.next_deadline_us;
+        const ProcessBackend *backend = get_process_backend();
+        uint64_t exit_us = backend->next_exit_us ? backend->next_exit_us() : 0;
+        if (exit_us > 0 && (wake_us == 0 || exit_us < wake_us)) wake_us = exit_us;
+        if (wake_us > 0) {
+            uint64_t now = monotonic_us();
+            uint64_t wait = wake_us > now ? wake_us - now : 0;
+            if (wait < 1000000) tv.tv_sec = 0, tv.tv_usec = wait;
+        }
+        int ret = select(max_fd + 1, &readfds, &writefds, &exceptfds, &tv);
 
-        if (ret > 0 && FD_ISSET(g_tm.server_fd, &readfds)) {
-            int client_fd = accept(g_tm.server_fd, NULL, NULL);
-            if (client_fd >= 0) {
-                handle_client(&g_tm, client_fd);
-                close(client_fd);
+        if (ret > 0) {
+            if (FD_ISSET(g_sigchld_pipe[0], &readfds)) drain_sigchld();
+            handle_pressure_events(&g_tm, &exceptfds);
+            handle_output(&g_tm, &readfds);
+            if (FD_ISSET(g_tm.notify_fd, &readfds)) handle_notify(&g_tm);
+            for (int i = g_tm.num_clients - 1; i >= 0; i--) {
+                ClientConn *c = &g_tm.clients[i];
+                bool open = true;
+                if (FD_ISSET(c->fd, &writefds)) open = flush_client(c);
+                if (open && FD_ISSET(c->fd, &readfds)) open = read_client(&g_tm, c);
+                if (!open) close_client(&g_tm, i);
+                if (!g_tm.running) break;
             }
+            if (FD_ISSET(g_tm.server_fd, &readfds)) accept_client(&g_tm);
         }
 
-        if (g_reload_requested) {
+        if (g_reload_requested && !g_tm.shutting_down) {
             g_reload_requested = 0;
             reload_config(&g_tm, g_config_path);
         }
+        update_pressure(&g_tm);
         update_processes(&g_tm);
+        flush_output_markers(&g_tm);
+        if (!g_tm.shutting_down) update_autoscale(&g_tm);
+        publish_status_board(&g_tm);
+
+        TMResponse report;
+        memset(&report, 0, sizeof(report));
+        if (g_tm.shutting_down && g_tm.running &&
+            shutdown_complete(&g_tm, report.response, sizeof(report.response))) {
+            g_tm.running = false;
+            if (g_tm.shutdown_client >= 0) {
+                report.id = g_tm.shutdown_req_id;
+                report.success = true;
+                queue_response(&g_tm, g_tm.shutdown_client, &report);
+            }
+        }
     }
 
+    drain_clients(&g_tm);
+    while (g_tm.num_clients > 0) close_client(&g_tm, g_tm.num_clients - 1);
+    close(g_tm.server_fd);
+    close(g_tm.notify_fd);
+    close_pressure(&g_tm);
+    close_status_board(&g_tm);
+    close(g_sigchld_pipe[0]);
+    close(g_sigchld_pipe[1]);
     unlink(SOCKET_PATH);
+    unlink(NOTIFY_SOCKET_PATH);
     free(g_config_path);
     return 0;
 }
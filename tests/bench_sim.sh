@@ -0,0 +1,70 @@
+#!/bin/bash
+# Benchmarks scheduler, status, reload and reaping costs on the simulated
+# backend. Usage: tests/bench_sim.sh [instances] [simulate-spec]
+
+set -u
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+INSTANCES="${1:-50000}"
+SPEC="${2:-exit_rate=0.005,stop_ms=50,seed=1}"
+CFG="$ROOT_DIR/tests/tmp_bench.yaml"
+LOG="$ROOT_DIR/bench_output.txt"
+CTL="$ROOT_DIR/taskmasterctl"
+
+write_config() {
+    cat > "$CFG" <<EOF_CFG
+programs:
+  bench:
+    cmd: "/bin/true"
+    numprocs: $INSTANCES
+    autostart: true
+    autorestart: always
+    startretries: 1000000
+    starttime: $1
+EOF_CFG
+}
+
+write_config 0
+"$ROOT_DIR/taskmasterd" --simulate="$SPEC" "$CFG" 2> "$LOG" &
+DAEMON_PID=$!
+for i in $(seq 1 600); do
+    "$CTL" status >/dev/null 2>&1 && break
+    sleep 0.1
+done
+
+# Waits for the Nth convergence, or gives up after SETTLE seconds
+SETTLE=120
+wait_converged() {
+    local deadline=$((SECONDS + SETTLE))
+    until [ "$(grep -c "Converged in" "$LOG")" -ge "$1" ]; do
+        if [ "$SECONDS" -ge "$deadline" ]; then
+            echo "convergence $1 not reached within $SETTLE s"
+            return 1
+        fi
+        sleep 0.2
+    done
+}
+
+wait_converged 1
+echo "instances:  $INSTANCES ($SPEC)"
+grep -o "Converged in [0-9.]* s" "$LOG" | head -n 1
+
+# A status reply stops at MAX_MSG_LEN (about 100 rows), so its cost does
+# not grow with the fleet; a full-table binary query covers every instance
+for i in $(seq 1 20); do echo status; done | "$CTL" -b >/dev/null
+for i in $(seq 1 5); do echo "query --binary"; done | "$CTL" -b >/dev/null
+sleep 5
+
+# Unchanged reload exercises slot matching, changed reload restarts everything
+"$CTL" reload >/dev/null
+sleep 2
+write_config 1
+"$CTL" reload >/dev/null
+wait_converged 3
+grep -o "Reload complete .*" "$LOG"
+
+"$CTL" stats | sed 's/^status    /status*   /'
+echo "* status replies are truncated at MAX_MSG_LEN; query is the full table"
+"$CTL" shutdown >/dev/null
+wait "$DAEMON_PID" 2>/dev/null
+rm -f "$CFG"
@@ -0,0 +1,29 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Sends READY=1 to $NOTIFY_SOCKET after READY_DELAY_MS, then idles.
+// With READY_DELAY_MS=-1 it never reports readiness.
+int main(void) {
+    const char *path = getenv("NOTIFY_SOCKET");
+    const char *delay = getenv("READY_DELAY_MS");
+    int delay_ms = delay ? atoi(delay) : 0;
+
+    if (path && delay_ms >= 0) {
+        usleep(delay_ms * 1000);
+        int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+        const char *msg = "STATUS=warmed up\nREADY=1";
+        sendto(fd, msg, strlen(msg), 0, (struct sockaddr *)&addr, sizeof(addr));
+        close(fd);
+    }
+
+    for (;;) pause();
+    return 0;
+}
@@ -0,0 +1,119 @@
+#!/bin/bash
+
+set -u
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+CFG="$ROOT_DIR/tests/tmp_autoscale.yaml"
+QUEUE="$ROOT_DIR/tests/tmp_autoscale.queue"
+SLOW="$ROOT_DIR/tests/tmp_autoscale_slow.sh"
+LOG="$ROOT_DIR/error_output.txt"
+DAEMON_PID=""
+
+pass() {
+    echo -e "${GREEN}[PASS]${NC} $1"
+}
+
+fail() {
+    echo -e "${RED}[FAIL]${NC} $1"
+    [ -f "$LOG" ] && { echo "--- daemon log ---"; cat "$LOG"; }
+    cleanup
+    exit 1
+}
+
+cleanup() {
+    "$ROOT_DIR/taskmasterctl" stop all >/dev/null 2>&1 || true
+    sleep 1
+    "$ROOT_DIR/taskmasterctl" shutdown >/dev/null 2>&1 || true
+    if [ -n "$DAEMON_PID" ]; then
+        wait "$DAEMON_PID" 2>/dev/null || true
+    fi
+    rm -f "$CFG" "$QUEUE" "$SLOW"
+}
+
+wait_for_daemon() {
+    local i
+    for i in $(seq 1 100); do
+        if "$ROOT_DIR/taskmasterctl" status >/dev/null 2>&1; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    return 1
+}
+
+instances() {
+    "$ROOT_DIR/taskmasterctl" status | grep -c "^pool .*RUNNING"
+}
+
+# Takes a second to exit after SIGTERM
+cat > "$SLOW" <<'EOF_SLOW'
+#!/bin/sh
+trap 'sleep 1; exit 0' TERM
+while :; do sleep 0.1; done
+EOF_SLOW
+chmod +x "$SLOW"
+
+echo 0 > "$QUEUE"
+cat > "$CFG" <<EOF_CFG
+programs:
+  pool:
+    cmd: "/bin/sleep 60"
+    numprocs_min: 1
+    numprocs_max: 3
+    scale_signal: file:$QUEUE
+    scale_up: 10
+    scale_down: 2
+    scale_interval: 1
+    scale_cooldown: 1
+  slow:
+    cmd: "$SLOW"
+    numprocs: 2
+    numprocs_min: 1
+    numprocs_max: 2
+    starttime: 0
+EOF_CFG
+
+echo "Testing queue-depth autoscaling..."
+"$ROOT_DIR/taskmasterd" "$CFG" 2> "$LOG" &
+DAEMON_PID=$!
+wait_for_daemon || fail "daemon did not become ready"
+
+sleep 2
+[ "$(instances)" -eq 1 ] && pass "stays at numprocs_min while idle" || fail "stays at numprocs_min while idle"
+
+echo 100 > "$QUEUE"
+sleep 5
+[ "$(instances)" -eq 3 ] && pass "grows to numprocs_max under load" || fail "grows to numprocs_max under load"
+grep -q "Scaling pool from 1 to 2 instances (load 100.0 above 10.0)" "$LOG" \
+    && pass "scale-up decision logged" || fail "scale-up decision logged"
+
+pids_before="$("$ROOT_DIR/taskmasterctl" status | awk '$1 == "pool" && $2 == 0 { print $5 }')"
+echo 0 > "$QUEUE"
+sleep 5
+status_out="$("$ROOT_DIR/taskmasterctl" status)"
+[ "$(instances)" -eq 1 ] && pass "shrinks to numprocs_min when idle" || fail "shrinks to numprocs_min when idle"
+echo "$status_out" | grep -Eq "^pool +0 +RUNNING +pid $pids_before" \
+    && pass "slot 0 kept its instance while scaling" || fail "slot 0 kept its instance while scaling"
+
+"$ROOT_DIR/taskmasterctl" scale pool 9 | grep -q "Scaled pool to 3 instances (bounds 1-3)" \
+    && pass "scale command clamps to bounds" || fail "scale command clamps to bounds"
+sleep 0.5
+[ "$(grep -c 'Started process pool\[2\]' "$LOG")" -eq 2 ] \
+    && pass "scale command starts slot 2" || fail "scale command starts slot 2"
+
+# Scaling back up while the dropped instance is still stopping restarts
+# its slot once it is reaped
+"$ROOT_DIR/taskmasterctl" scale slow 1 > /dev/null
+sleep 0.3
+"$ROOT_DIR/taskmasterctl" scale slow 2 > /dev/null
+sleep 2.5
+[ "$("$ROOT_DIR/taskmasterctl" status | grep -c "^slow .*RUNNING")" -eq 2 ] \
+    && pass "slot scaled up while stopping is restarted" || fail "slot scaled up while stopping is restarted"
+
+cleanup
+rm -f "$LOG"
+echo -e "${GREEN}Autoscaling test passed!${NC}"
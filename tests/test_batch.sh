@@ -0,0 +1,154 @@
+#!/bin/bash
+
+set -u
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+CFG="$ROOT_DIR/tests/tmp_batch.yaml"
+BATCH="$ROOT_DIR/tests/tmp_batch.cmds"
+OUT="$ROOT_DIR/tests/tmp_batch.out"
+LOG="$ROOT_DIR/error_output.txt"
+DAEMON_PID=""
+
+pass() {
+    echo -e "${GREEN}[PASS]${NC} $1"
+}
+
+fail() {
+    echo -e "${RED}[FAIL]${NC} $1"
+    [ -f "$LOG" ] && { echo "--- daemon log ---"; cat "$LOG"; }
+    cleanup
+    exit 1
+}
+
+cleanup() {
+    "$ROOT_DIR/taskmasterctl" shutdown >/dev/null 2>&1 || true
+    if [ -n "$DAEMON_PID" ]; then
+        wait "$DAEMON_PID" 2>/dev/null || true
+    fi
+    rm -f "$CFG" "$BATCH" "$OUT"
+}
+
+wait_for_daemon() {
+    local i
+    for i in $(seq 1 100); do
+        if "$ROOT_DIR/taskmasterctl" status >/dev/null 2>&1; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    return 1
+}
+
+cat > "$CFG" <<EOF_CFG
+programs:
+  batch_sleeper:
+    cmd: "/bin/sleep 30"
+    autostart: false
+EOF_CFG
+
+echo "Testing pipelined batch mode..."
+"$ROOT_DIR/taskmasterd" "$CFG" 2> "$LOG" &
+DAEMON_PID=$!
+wait_for_daemon || fail "daemon did not become ready"
+
+{
+    echo "start batch_sleeper"
+    for i in $(seq 1 300); do echo "status"; done
+    echo "stop batch_sleeper"
+} > "$BATCH"
+
+if "$ROOT_DIR/taskmasterctl" --json --batch "$BATCH" > "$OUT"; then
+    pass "batch of 302 commands completed"
+else
+    fail "batch of 302 commands completed"
+fi
+
+count="$(grep -c '"success":true' "$OUT")"
+[ "$count" -eq 302 ] && pass "every batched command got a reply ($count)" \
+    || fail "every batched command got a reply (got $count)"
+
+first_id="$(head -n 1 "$OUT" | sed -E 's/^\{"id":([0-9]+),.*/\1/')"
+last_id="$(tail -n 1 "$OUT" | sed -E 's/^\{"id":([0-9]+),.*/\1/')"
+[ "$first_id" -eq 1 ] && [ "$last_id" -eq 302 ] && pass "replies matched to request ids in order" \
+    || fail "replies matched to request ids in order (first=$first_id last=$last_id)"
+
+head -n 1 "$OUT" | grep -q '"command":"start batch_sleeper"' && pass "json output names the command" \
+    || fail "json output names the command"
+
+sed -n 2p "$OUT" | grep -q '^{"id":2,"command":"status","success":true,"processes":\[{"name":"batch_sleeper","group":"","index":0,"state":"[A-Z]*","pid":[0-9]*,' \
+    && pass "json status has one record per instance" || fail "json status has one record per instance"
+
+conns="$(grep -c "Client requested" "$LOG")"
+[ "$conns" -eq 2 ] && pass "start/stop served from the batch" || fail "start/stop served from the batch (got $conns)"
+
+if printf 'status\nbogus\n' | "$ROOT_DIR/taskmasterctl" --batch > /dev/null 2>&1; then
+    fail "unknown command in batch makes the batch fail"
+else
+    pass "unknown command in batch makes the batch fail"
+fi
+
+# Raw protocol clients: one stalls in the middle of a request, the other
+# pipelines requests and never reads a reply. Neither may block the daemon.
+raw_client() {
+    perl -MIO::Socket::UNIX -e '
+        my ($mode, $path) = @ARGV;
+        my $s = IO::Socket::UNIX->new(Peer => $path) or exit 1;
+        if ($mode eq "partial") {
+            syswrite($s, "\x01\x00\x00\x00\x00");
+        } elsif ($mode eq "idle") {
+            syswrite($s, pack("LLLa64", 1, 0, 0, ""));
+        } else {
+            syswrite($s, pack("LLLa64", $_, 0, 0, "")) for 1 .. 400;
+        }
+        sleep 30;' "$1" /tmp/taskmaster.sock &
+}
+
+raw_client partial
+PARTIAL_PID=$!
+raw_client flood
+FLOOD_PID=$!
+sleep 1
+if timeout 5 "$ROOT_DIR/taskmasterctl" status > /dev/null; then
+    pass "stalled and non-reading clients do not block the daemon"
+else
+    kill "$PARTIAL_PID" "$FLOOD_PID" 2>/dev/null
+    fail "stalled and non-reading clients do not block the daemon"
+fi
+kill "$PARTIAL_PID" "$FLOOD_PID" 2>/dev/null
+wait "$PARTIAL_PID" "$FLOOD_PID" 2>/dev/null
+
+# Replies carry only the used part of the response
+frame="$(perl -MIO::Socket::UNIX -e '
+    my $s = IO::Socket::UNIX->new(Peer => $ARGV[0]) or exit 1;
+    syswrite($s, pack("LLLa64", 7, 1, 0, "batch_nobody"));
+    sleep 1;
+    my $n = sysread($s, my $buf, 65536);
+    my ($id, $ok, $more, $len) = unpack("LCCxxL", $buf);
+    print "$n $id $len ", substr($buf, 12, $len);' /tmp/taskmaster.sock)"
+[[ "$frame" =~ ^([0-9]+)\ 7\ ([0-9]+)\  ]] && [ "${BASH_REMATCH[1]}" -eq $((12 + BASH_REMATCH[2])) ] \
+    && [ "${BASH_REMATCH[1]}" -lt 200 ] && pass "replies are sized to their content" \
+    || fail "replies are sized to their content (got: $frame)"
+
+# Idle connections that sent a command and stayed open must not lock out
+# new controllers once the connection table is full
+IDLE_PIDS=""
+for i in $(seq 1 40); do
+    raw_client idle
+    IDLE_PIDS="$IDLE_PIDS $!"
+done
+sleep 1
+if timeout 5 "$ROOT_DIR/taskmasterctl" status > /dev/null; then
+    pass "idle connections are evicted for new clients"
+else
+    kill $IDLE_PIDS 2>/dev/null
+    fail "idle connections are evicted for new clients"
+fi
+kill $IDLE_PIDS 2>/dev/null
+wait $IDLE_PIDS 2>/dev/null
+
+cleanup
+echo -e "${GREEN}Batch mode test passed!${NC}"
@@ -265,6 +265,34 @@ EOF
     assert_grep "failed to start after 2 retries" "$ROOT_DIR/error_output.txt" "startretries exhaustion handled"
 }
 
+test_placement_applied() {
+    cat > "$ROOT_DIR/tests/tmp_placement.yaml" <<EOF
+programs:
+  placed:
+    cmd: "/bin/sleep 30"
+    numprocs: 2
+    cpu_affinity: per_index
+    nice: 7
+    sched_policy: batch
+    ioprio: be/6
+  listed:
+    cmd: "/bin/sleep 30"
+    cpu_affinity: "0"
+EOF
+
+    start_daemon "$ROOT_DIR/tests/tmp_placement.yaml"
+    sleep 1
+
+    local status_out
+    status_out="$("$ROOT_DIR/taskmasterctl" status)"
+    assert_grep "placed[[:space:]]+1[[:space:]]+RUNNING[[:space:]]+pid [0-9]+ cpus [0-9]+ nice 7 sched batch io be/6" \
+        <(echo "$status_out") "nice, sched_policy and ioprio applied and reported"
+    assert_grep "listed[[:space:]]+0[[:space:]]+RUNNING[[:space:]]+pid [0-9]+ cpus 0$" \
+        <(echo "$status_out") "explicit cpu_affinity applied and reported"
+    "$ROOT_DIR/taskmasterctl" stop all >/dev/null
+    stop_daemon
+}
+
 test_exitcodes_unexpected_policy() {
     if ! timeout 25s bash "$ROOT_DIR/tests/test_exitcodes.sh" >/tmp/test_exitcodes.out 2>&1; then
         cat /tmp/test_exitcodes.out
@@ -282,6 +310,7 @@ final_cleanup() {
           "$ROOT_DIR/tests/tmp_env_multi.yaml" \
           "$ROOT_DIR/tests/tmp_env_multi.out" \
           "$ROOT_DIR/tests/tmp_restart.yaml" \
+          "$ROOT_DIR/tests/tmp_placement.yaml" \
           /tmp/test_exitcodes.out
     rm -rf "$ROOT_DIR/tests/tmp_cfg_probe"
 }
@@ -294,6 +323,7 @@ test_numprocs_autostart_and_stopsignal
 test_starttime_transition
 test_env_does_not_swallow_sibling_program
 test_restart_policy_always_and_retries
+test_placement_applied
 test_exitcodes_unexpected_policy
 
 final_cleanup
@@ -0,0 +1,177 @@
+#!/bin/bash
+
+set -u
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+CFG="$ROOT_DIR/tests/tmp_deps.yaml"
+SLOW="$ROOT_DIR/tests/tmp_deps_slow.sh"
+LOG="$ROOT_DIR/error_output.txt"
+DAEMON_PID=""
+
+pass() {
+    echo -e "${GREEN}[PASS]${NC} $1"
+}
+
+fail() {
+    echo -e "${RED}[FAIL]${NC} $1"
+    [ -f "$LOG" ] && { echo "--- daemon log ---"; cat "$LOG"; }
+    cleanup
+    exit 1
+}
+
+cleanup() {
+    "$ROOT_DIR/taskmasterctl" shutdown >/dev/null 2>&1 || true
+    if [ -n "$DAEMON_PID" ]; then
+        wait "$DAEMON_PID" 2>/dev/null || true
+    fi
+    rm -f "$CFG" "$SLOW"
+}
+
+wait_for_daemon() {
+    local i
+    for i in $(seq 1 100); do
+        if "$ROOT_DIR/taskmasterctl" status >/dev/null 2>&1; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    return 1
+}
+
+# Line number of the first log line matching a pattern
+log_line() {
+    grep -n -E "$1" "$LOG" | head -n 1 | cut -d: -f1
+}
+
+# Line number of the first log line after line $1 matching a pattern
+log_line_after() {
+    grep -n -E "$2" "$LOG" | awk -F: -v n="$1" '$1 > n { print $1; exit }'
+}
+
+echo "Testing dependency waves..."
+cat > "$CFG" <<EOF_CFG
+programs:
+  frontend:
+    cmd: "/bin/sleep 30"
+    starttime: 1
+    depends_on: [backend]
+  backend:
+    cmd: "/bin/sleep 30"
+    starttime: 1
+    numprocs: 2
+    depends_on:
+      - database
+  database:
+    cmd: "/bin/sleep 30"
+    starttime: 1
+EOF_CFG
+
+"$ROOT_DIR/taskmasterd" "$CFG" 2> "$LOG" &
+DAEMON_PID=$!
+wait_for_daemon || fail "daemon did not become ready"
+
+"$ROOT_DIR/taskmasterctl" status | grep -Eq "^frontend.*waiting on dependencies" \
+    && pass "dependent program waits for its dependencies" \
+    || fail "dependent program waits for its dependencies"
+
+for i in $(seq 1 60); do
+    grep -q "Converged in" "$LOG" && break
+    sleep 0.1
+done
+grep -Eq "Converged in [0-9.]+ s: 4 instances running, 0 waiting" "$LOG" \
+    && pass "boot convergence measured" || fail "boot convergence measured"
+
+db="$(log_line 'Started process database\[0\]')"
+be="$(log_line 'Started process backend\[1\]')"
+fe="$(log_line 'Started process frontend\[0\]')"
+[ "$db" -lt "$be" ] && [ "$be" -lt "$fe" ] && pass "waves start in topological order" \
+    || fail "waves start in topological order"
+
+"$ROOT_DIR/taskmasterctl" stop all >/dev/null
+sleep 4
+fe="$(log_line 'Stopping process frontend\[0\]')"
+be="$(log_line 'Stopping process backend\[0\]')"
+db="$(log_line 'Stopping process database\[0\]')"
+[ -n "$db" ] && [ "$fe" -lt "$be" ] && [ "$be" -lt "$db" ] && pass "stop all follows reverse topological order" \
+    || fail "stop all follows reverse topological order"
+cleanup
+DAEMON_PID=""
+
+echo "Testing dependency order on reload..."
+cat > "$SLOW" <<'EOF_SLOW'
+#!/bin/sh
+trap 'sleep 1; exit 0' TERM
+while true; do sleep 0.1; done
+EOF_SLOW
+chmod +x "$SLOW"
+
+write_reload_config() {
+    cat > "$CFG" <<EOF_CFG
+programs:
+  frontend:
+    cmd: "$SLOW"
+    depends_on: [backend]
+  backend:
+    cmd: "$SLOW"
+    depends_on: [database]
+  database:
+    cmd: "/bin/sleep $1"
+EOF_CFG
+}
+
+all_running() {
+    [ "$("$ROOT_DIR/taskmasterctl" status | grep -c RUNNING)" -eq 3 ]
+}
+
+write_reload_config 30
+"$ROOT_DIR/taskmasterd" "$CFG" 2> "$LOG" &
+DAEMON_PID=$!
+wait_for_daemon || fail "daemon did not become ready"
+for i in $(seq 1 50); do all_running && break; sleep 0.1; done
+all_running || fail "reload test programs are running"
+
+# Only database changes; its dependents are restarted around it
+reload="$(wc -l < "$LOG")"
+write_reload_config 31
+"$ROOT_DIR/taskmasterctl" reload > /dev/null
+sleep 4
+fe="$(log_line_after "$reload" 'Process frontend\[0\] exited')"
+be="$(log_line_after "$reload" 'Stopping process backend\[0\]')"
+be_exit="$(log_line_after "$reload" 'Process backend\[0\] exited')"
+db="$(log_line_after "$reload" 'Stopping process database\[0\]')"
+[ -n "$fe" ] && [ -n "$be" ] && [ -n "$be_exit" ] && [ -n "$db" ] && [ "$fe" -lt "$be" ] && [ "$be_exit" -lt "$db" ] \
+    && pass "reload stops a dependency only after its dependents exited" \
+    || fail "reload stops a dependency only after its dependents exited"
+
+db="$(log_line_after "$reload" 'Started process database\[0\]')"
+fe="$(log_line_after "$reload" 'Started process frontend\[0\]')"
+[ -n "$db" ] && [ -n "$fe" ] && [ "$db" -lt "$fe" ] && all_running \
+    && pass "dependents of a changed program are restarted after it" \
+    || fail "dependents of a changed program are restarted after it"
+cleanup
+DAEMON_PID=""
+
+echo "Testing dependency cycle detection..."
+cat > "$CFG" <<EOF_CFG
+programs:
+  left:
+    cmd: "/bin/sleep 30"
+    depends_on: right
+  right:
+    cmd: "/bin/sleep 30"
+    depends_on: left
+EOF_CFG
+
+if timeout 5 "$ROOT_DIR/taskmasterd" "$CFG" 2> "$LOG"; then
+    fail "daemon refuses a configuration with a cycle"
+fi
+grep -q "dependency cycle detected involving: left, right" "$LOG" \
+    && pass "daemon refuses a configuration with a cycle" \
+    || fail "daemon refuses a configuration with a cycle"
+
+rm -f "$CFG" "$LOG"
+echo -e "${GREEN}Dependency test passed!${NC}"
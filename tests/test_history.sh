@@ -0,0 +1,91 @@
+#!/bin/bash
+
+set -u
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+CFG="$ROOT_DIR/tests/tmp_history.yaml"
+LOG="$ROOT_DIR/error_output.txt"
+DAEMON_PID=""
+
+pass() {
+    echo -e "${GREEN}[PASS]${NC} $1"
+}
+
+fail() {
+    echo -e "${RED}[FAIL]${NC} $1"
+    [ -f "$LOG" ] && { echo "--- daemon log ---"; cat "$LOG"; }
+    cleanup
+    exit 1
+}
+
+cleanup() {
+    "$ROOT_DIR/taskmasterctl" shutdown >/dev/null 2>&1 || true
+    if [ -n "$DAEMON_PID" ]; then
+        wait "$DAEMON_PID" 2>/dev/null || true
+    fi
+    rm -f "$CFG"
+}
+
+wait_for_daemon() {
+    local i
+    for i in $(seq 1 100); do
+        if "$ROOT_DIR/taskmasterctl" status >/dev/null 2>&1; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    return 1
+}
+
+gcc "$ROOT_DIR/tests/exit42.c" -o "$ROOT_DIR/tests/exit42" || fail "build exit42 helper"
+
+cat > "$CFG" <<EOF_CFG
+programs:
+  flapper:
+    cmd: "$ROOT_DIR/tests/exit42"
+    autorestart: always
+    startretries: 100
+  steady:
+    cmd: "/bin/sleep 30"
+    autostart: false
+EOF_CFG
+
+echo "Testing per-process event history..."
+"$ROOT_DIR/taskmasterd" "$CFG" 2> "$LOG" &
+DAEMON_PID=$!
+wait_for_daemon || fail "daemon did not become ready"
+
+"$ROOT_DIR/taskmasterctl" start steady >/dev/null
+sleep 1
+"$ROOT_DIR/taskmasterctl" stop steady >/dev/null
+sleep 5
+
+out="$("$ROOT_DIR/taskmasterctl" history steady)"
+echo "$out" | grep -Eq "^steady +0 .* START +pid [0-9]+" && pass "start recorded with pid" \
+    || fail "start recorded with pid"
+echo "$out" | grep -Eq "^steady +0 .* STOP +signal 15" && pass "stop recorded with signal" \
+    || fail "stop recorded with signal"
+echo "$out" | grep -Eq "^steady +0 .* SIGNAL +signal 15 after [0-9]+ ms" && pass "termination recorded with runtime" \
+    || fail "termination recorded with runtime"
+
+out="$("$ROOT_DIR/taskmasterctl" history flapper)"
+echo "$out" | grep -Eq "EXIT +code 42 \(unexpected\) after [0-9]+ ms" && pass "exit code recorded" \
+    || fail "exit code recorded"
+echo "$out" | grep -Eq "RESTART +attempt [0-9]+" && pass "restart recorded" || fail "restart recorded"
+events="$(echo "$out" | grep -c "^flapper")"
+[ "$events" -eq 16 ] && pass "history ring is bounded (16 events)" \
+    || fail "history ring is bounded (got $events events)"
+
+if "$ROOT_DIR/taskmasterctl" history missing | grep -q "No such program: missing"; then
+    pass "unknown program reported"
+else
+    fail "unknown program reported"
+fi
+
+cleanup
+rm -f "$LOG"
+echo -e "${GREEN}History test passed!${NC}"
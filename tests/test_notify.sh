@@ -0,0 +1,91 @@
+#!/bin/bash
+
+set -u
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+CFG="$ROOT_DIR/tests/tmp_notify.yaml"
+HELPER="$ROOT_DIR/tests/notify_ready"
+LOG="$ROOT_DIR/error_output.txt"
+DAEMON_PID=""
+
+pass() {
+    echo -e "${GREEN}[PASS]${NC} $1"
+}
+
+fail() {
+    echo -e "${RED}[FAIL]${NC} $1"
+    [ -f "$LOG" ] && { echo "--- daemon log ---"; cat "$LOG"; }
+    cleanup
+    exit 1
+}
+
+cleanup() {
+    "$ROOT_DIR/taskmasterctl" stop all >/dev/null 2>&1 || true
+    sleep 1
+    "$ROOT_DIR/taskmasterctl" shutdown >/dev/null 2>&1 || true
+    if [ -n "$DAEMON_PID" ]; then
+        wait "$DAEMON_PID" 2>/dev/null || true
+    fi
+    rm -f "$CFG" "$HELPER"
+}
+
+wait_for_daemon() {
+    local i
+    for i in $(seq 1 100); do
+        if "$ROOT_DIR/taskmasterctl" status >/dev/null 2>&1; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    return 1
+}
+
+gcc "$ROOT_DIR/tests/notify_ready.c" -o "$HELPER" || fail "build notify helper"
+
+cat > "$CFG" <<EOF_CFG
+programs:
+  notifier:
+    cmd: "$HELPER"
+    ready: notify
+    starttime: 30
+    env:
+      READY_DELAY_MS: 300
+  silent:
+    cmd: "$HELPER"
+    ready: notify
+    starttime: 2
+    autorestart: never
+    env:
+      READY_DELAY_MS: -1
+EOF_CFG
+
+echo "Testing readiness notification..."
+"$ROOT_DIR/taskmasterd" "$CFG" 2> "$LOG" &
+DAEMON_PID=$!
+wait_for_daemon || fail "daemon did not become ready"
+
+"$ROOT_DIR/taskmasterctl" status | grep -Eq "^notifier[[:space:]]+0[[:space:]]+STARTING" \
+    && pass "notify program stays STARTING until it reports" \
+    || fail "notify program stays STARTING until it reports"
+
+sleep 1
+"$ROOT_DIR/taskmasterctl" status | grep -Eq "^notifier[[:space:]]+0[[:space:]]+RUNNING.*status: warmed up" \
+    && pass "READY=1 promotes to RUNNING long before starttime" \
+    || fail "READY=1 promotes to RUNNING long before starttime"
+grep -Eq "notifier\[0\] reported ready after [0-9]+ ms \(notify latency [0-9]+ us\)" "$LOG" \
+    && pass "notification latency logged" || fail "notification latency logged"
+
+sleep 2
+grep -q "silent\[0\] did not report readiness within 2 s" "$LOG" \
+    && pass "starttime acts as readiness timeout" || fail "starttime acts as readiness timeout"
+"$ROOT_DIR/taskmasterctl" status | grep -Eq "^silent[[:space:]]+0[[:space:]]+EXITED" \
+    && pass "timed out start is treated as a failed start" \
+    || fail "timed out start is treated as a failed start"
+
+cleanup
+rm -f "$LOG"
+echo -e "${GREEN}Readiness notification test passed!${NC}"
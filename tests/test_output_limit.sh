@@ -0,0 +1,131 @@
+#!/bin/bash
+
+set -u
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+CFG="$ROOT_DIR/tests/tmp_output.yaml"
+FLOOD="$ROOT_DIR/tests/tmp_output_flood.sh"
+OUT_DROP="$ROOT_DIR/tests/tmp_output_drop.log"
+OUT_SAMPLE="$ROOT_DIR/tests/tmp_output_sample.log"
+FAREWELL="$ROOT_DIR/tests/tmp_output_farewell.sh"
+OUT_FAREWELL="$ROOT_DIR/tests/tmp_output_farewell.log"
+LOG="$ROOT_DIR/error_output.txt"
+DAEMON_PID=""
+
+pass() {
+    echo -e "${GREEN}[PASS]${NC} $1"
+}
+
+fail() {
+    echo -e "${RED}[FAIL]${NC} $1"
+    [ -f "$LOG" ] && { echo "--- daemon log ---"; cat "$LOG"; }
+    cleanup
+    exit 1
+}
+
+cleanup() {
+    "$ROOT_DIR/taskmasterctl" stop all >/dev/null 2>&1 || true
+    sleep 1
+    "$ROOT_DIR/taskmasterctl" shutdown >/dev/null 2>&1 || true
+    if [ -n "$DAEMON_PID" ]; then
+        wait "$DAEMON_PID" 2>/dev/null || true
+    fi
+    rm -f "$CFG" "$FLOOD" "$OUT_DROP" "$OUT_SAMPLE" "$FAREWELL" "$OUT_FAREWELL"
+}
+
+wait_for_daemon() {
+    local i
+    for i in $(seq 1 100); do
+        if "$ROOT_DIR/taskmasterctl" status >/dev/null 2>&1; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    return 1
+}
+
+# Writes 20000 numbered lines at once, then stays quiet
+cat > "$FLOOD" <<'EOF_FLOOD'
+#!/bin/sh
+seq 1 20000 | sed 's/^/line /'
+exec sleep 60
+EOF_FLOOD
+chmod +x "$FLOOD"
+rm -f "$OUT_DROP" "$OUT_SAMPLE"
+
+cat > "$CFG" <<EOF_CFG
+programs:
+  flood:
+    cmd: "$FLOOD"
+    stdout: $OUT_DROP
+    output_lines_per_sec: 10
+    output_bytes_per_sec: 100000
+  sampled:
+    cmd: "$FLOOD"
+    stdout: $OUT_SAMPLE
+    output_lines_per_sec: 10
+    output_overflow: sample
+    output_sample_every: 1000
+EOF_CFG
+
+echo "Testing output rate limiting..."
+"$ROOT_DIR/taskmasterd" "$CFG" 2> "$LOG" &
+DAEMON_PID=$!
+wait_for_daemon || fail "daemon did not become ready"
+
+# The suppressed run is summarized once the flood has been quiet for a second
+for i in $(seq 1 50); do
+    grep -q "suppressed" "$OUT_DROP" 2>/dev/null && grep -q "suppressed" "$OUT_SAMPLE" 2>/dev/null && break
+    sleep 0.2
+done
+
+kept=$(grep -c "^line " "$OUT_DROP")
+[ "$kept" -ge 10 ] && [ "$kept" -le 20 ] || fail "flood kept $kept lines, expected about one second of budget"
+grep -q "^\[taskmaster\] [0-9]* bytes suppressed ([0-9]* lines, output over budget)$" "$OUT_DROP" || fail "no suppressed marker in the log"
+suppressed=$(sed -n 's/.*bytes suppressed (\([0-9]*\) lines.*/\1/p' "$OUT_DROP" | awk '{ s += $1 } END { print s }')
+[ $((kept + suppressed)) -eq 20000 ] || fail "kept $kept + suppressed $suppressed lines do not add up to 20000"
+pass "over-budget lines are dropped and summarized"
+
+# About one second of budget plus one line per 1000 suppressed
+kept=$(grep -c "^line " "$OUT_SAMPLE")
+[ "$kept" -ge 25 ] && [ "$kept" -le 40 ] || fail "sample mode kept $kept lines, expected about 30"
+pass "sample mode keeps every Nth suppressed line"
+
+status=$("$ROOT_DIR/taskmasterctl" status)
+echo "$status" | grep -q "^output: flood [0-9]* bytes/$suppressed lines suppressed, sampled [0-9]* bytes/[0-9]* lines suppressed [0-9]* sampled$" \
+    || { echo "$status"; fail "status does not report suppressed output"; }
+pass "status reports suppressed output per program"
+
+# A program removed by a reload can still write while it stops
+cat > "$FAREWELL" <<'EOF_FAREWELL'
+#!/bin/sh
+trap 'sleep 0.5; echo goodbye; exit 0' TERM
+while :; do sleep 0.1; done
+EOF_FAREWELL
+chmod +x "$FAREWELL"
+cat > "$CFG" <<EOF_CFG
+programs:
+  farewell:
+    cmd: "$FAREWELL"
+    stdout: $OUT_FAREWELL
+    output_lines_per_sec: 10
+EOF_CFG
+"$ROOT_DIR/taskmasterctl" reload > /dev/null
+sleep 2
+cat > "$CFG" <<EOF_CFG
+programs:
+  other:
+    cmd: "/bin/sleep 60"
+EOF_CFG
+"$ROOT_DIR/taskmasterctl" reload > /dev/null
+sleep 2
+grep -q "^goodbye$" "$OUT_FAREWELL" || fail "output written while stopping after a reload was lost"
+grep -q "Process farewell\[0\] exited with code 0" "$LOG" || fail "removed program did not exit cleanly"
+pass "output stays captured until a removed program is reaped"
+
+cleanup
+echo "Output rate limiting tests passed."
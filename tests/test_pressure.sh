@@ -0,0 +1,99 @@
+#!/bin/bash
+
+set -u
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+CFG="$ROOT_DIR/tests/tmp_pressure.yaml"
+PSI="$ROOT_DIR/tests/tmp_pressure.memory"
+LOG="$ROOT_DIR/error_output.txt"
+DAEMON_PID=""
+
+pass() {
+    echo -e "${GREEN}[PASS]${NC} $1"
+}
+
+fail() {
+    echo -e "${RED}[FAIL]${NC} $1"
+    [ -f "$LOG" ] && { echo "--- daemon log ---"; cat "$LOG"; }
+    cleanup
+    exit 1
+}
+
+cleanup() {
+    "$ROOT_DIR/taskmasterctl" stop all >/dev/null 2>&1 || true
+    sleep 1
+    "$ROOT_DIR/taskmasterctl" shutdown >/dev/null 2>&1 || true
+    if [ -n "$DAEMON_PID" ]; then
+        wait "$DAEMON_PID" 2>/dev/null || true
+    fi
+    rm -f "$CFG" "$PSI"
+}
+
+wait_for_daemon() {
+    local i
+    for i in $(seq 1 100); do
+        if "$ROOT_DIR/taskmasterctl" status >/dev/null 2>&1; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    return 1
+}
+
+# A PSI file without total= makes the daemon use avg10 as the level
+set_pressure() {
+    printf 'some avg10=%s avg60=0.00 avg300=0.00\nfull avg10=0.00 avg60=0.00 avg300=0.00\n' "$1" > "$PSI"
+}
+
+set_pressure 0.00
+cat > "$CFG" <<EOF_CFG
+pressure:
+  memory: 20
+  memory_source: $PSI
+  critical_priority: 100
+  admit_rate: 0
+programs:
+  batch:
+    cmd: "/bin/sleep 60"
+    autostart: false
+    priority: 500
+  core:
+    cmd: "/bin/sleep 60"
+    autostart: false
+    priority: 10
+EOF_CFG
+
+echo "Testing pressure-aware spawn admission..."
+"$ROOT_DIR/taskmasterd" "$CFG" 2> "$LOG" &
+DAEMON_PID=$!
+wait_for_daemon || fail "daemon did not become ready"
+
+grep -q "Monitoring memory pressure above 20.0% from $PSI (polling)" "$LOG" || fail "pressure source was not monitored"
+pass "pressure source is monitored"
+
+set_pressure 75.00
+sleep 2
+"$ROOT_DIR/taskmasterctl" status | grep -q "^pressure: memory 75.00%/20.00% HIGH" || fail "status does not report high pressure"
+pass "status reports high pressure"
+
+"$ROOT_DIR/taskmasterctl" start batch >/dev/null
+"$ROOT_DIR/taskmasterctl" start core >/dev/null
+sleep 1
+status=$("$ROOT_DIR/taskmasterctl" status)
+echo "$status" | grep -q "^batch .*STOPPED .*(deferred by pressure)" || fail "non-critical start was not deferred"
+echo "$status" | grep -q "^core .*RUNNING" || fail "critical start was held back"
+echo "$status" | grep -q "1 waiting, 1 deferred batch:1" || fail "deferral counts missing from status"
+pass "non-critical start deferred, critical start admitted"
+
+set_pressure 0.00
+sleep 2
+"$ROOT_DIR/taskmasterctl" status | grep -q "^batch .*RUNNING" || fail "deferred start did not resume"
+grep -q "Resource pressure cleared after [0-9]* ms, resuming 1 deferred starts" "$LOG" || fail "pressure clearing was not logged"
+pass "deferred start resumes once pressure drops"
+
+cleanup
+echo "Pressure admission tests passed."
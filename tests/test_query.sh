@@ -0,0 +1,111 @@
+#!/bin/bash
+
+set -u
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+CFG="$ROOT_DIR/tests/tmp_query.yaml"
+LOG="$ROOT_DIR/error_output.txt"
+DAEMON_PID=""
+
+pass() {
+    echo -e "${GREEN}[PASS]${NC} $1"
+}
+
+fail() {
+    echo -e "${RED}[FAIL]${NC} $1"
+    [ -f "$LOG" ] && { echo "--- daemon log ---"; cat "$LOG"; }
+    cleanup
+    exit 1
+}
+
+cleanup() {
+    "$ROOT_DIR/taskmasterctl" stop all >/dev/null 2>&1 || true
+    sleep 1
+    "$ROOT_DIR/taskmasterctl" shutdown >/dev/null 2>&1 || true
+    if [ -n "$DAEMON_PID" ]; then
+        wait "$DAEMON_PID" 2>/dev/null || true
+    fi
+    rm -f "$CFG"
+}
+
+wait_for_daemon() {
+    local i
+    for i in $(seq 1 100); do
+        if "$ROOT_DIR/taskmasterctl" status >/dev/null 2>&1; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    return 1
+}
+
+query() {
+    "$ROOT_DIR/taskmasterctl" query "$@"
+}
+
+count() {
+    grep -o '"name":' | wc -l
+}
+
+cat > "$CFG" <<EOF_CFG
+programs:
+  web:
+    cmd: "/bin/sleep 60"
+    numprocs: 2
+    group: front
+  web-api:
+    cmd: "/bin/sleep 60"
+    group: front
+  crashy:
+    cmd: "/bin/false"
+    autorestart: never
+  fleet:
+    cmd: "/bin/sleep 60"
+    numprocs: 100
+EOF_CFG
+
+echo "Testing indexed status queries..."
+"$ROOT_DIR/taskmasterd" "$CFG" 2> "$LOG" &
+DAEMON_PID=$!
+wait_for_daemon || fail "daemon did not become ready"
+for i in $(seq 1 100); do
+    [ "$(query state=RUNNING | count)" -eq 103 ] && break
+    sleep 0.2
+done
+
+[ "$(query web | count)" -eq 2 ] || fail "exact name matched the wrong instances"
+[ "$(query 'name=web*' | count)" -eq 3 ] || fail "glob did not match web and web-api"
+[ "$(query group=front | count)" -eq 3 ] || fail "group filter did not match its members"
+[ "$(query state=running group=front | count)" -eq 3 ] || fail "state and group filters do not combine"
+[ "$(query missing | count)" -eq 0 ] || fail "unknown program matched instances"
+pass "name, glob, group and state filters"
+
+query web-api | grep -q '"group":"front","index":0,"state":"RUNNING","pid":[1-9][0-9]*,"uptime":[0-9]*,"restarts":0,"last_exit":null' \
+    || fail "running instance record is incomplete"
+query crashy | grep -q '"state":"EXITED","pid":0,"uptime":0,"restarts":0,"last_exit":{"code":1,"expected":false}' \
+    || fail "last exit reason missing"
+pass "records carry uptime, restarts and the last exit reason"
+
+# 104 records do not fit one response and are split across frames
+all=$(query)
+[ "$(echo "$all" | count)" -eq 104 ] || fail "multi-frame reply lost records"
+echo "$all" | grep -q '^{"id":1,"command":"query","success":true,"processes":\[{.*}\]}$' || fail "frames were not joined into one array"
+echo "$all" | grep -q '}{' && fail "frames were joined without a separator"
+bytes=$("$ROOT_DIR/taskmasterctl" query --binary fleet | wc -c)
+fleet_bytes=$("$ROOT_DIR/taskmasterctl" query --binary crashy | wc -c)
+[ "$bytes" -eq $((fleet_bytes * 100)) ] || fail "binary reply is $bytes bytes, expected 100 records of $fleet_bytes"
+pass "large replies span several frames in JSON and binary"
+
+query state=bogus >/dev/null 2>&1 && fail "bad state was accepted"
+out=$(printf 'query crashy\nquery fleet\nquery nope=1\nstatus\n' | "$ROOT_DIR/taskmasterctl" --batch)
+[ "$(echo "$out" | grep -c '^{"id"')" -eq 2 ] || fail "batch did not keep query replies apart"
+echo "$out" | grep -q "^Unknown filter: nope" || fail "bad filter not reported in batch"
+echo "$out" | grep -q "^crashy .*EXITED" || fail "reply after a multi-frame query was lost"
+pass "errors and pipelined queries"
+
+cleanup
+echo "Query tests passed."
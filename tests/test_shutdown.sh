@@ -0,0 +1,135 @@
+#!/bin/bash
+
+set -u
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+CFG="$ROOT_DIR/tests/tmp_shutdown.yaml"
+STUBBORN="$ROOT_DIR/tests/tmp_stubborn.sh"
+LOG="$ROOT_DIR/error_output.txt"
+REPORT="$ROOT_DIR/tests/tmp_shutdown_report.txt"
+DAEMON_PID=""
+PIDS=""
+
+pass() {
+    echo -e "${GREEN}[PASS]${NC} $1"
+}
+
+fail() {
+    echo -e "${RED}[FAIL]${NC} $1"
+    [ -f "$LOG" ] && { echo "--- daemon log ---"; cat "$LOG"; }
+    cleanup
+    exit 1
+}
+
+cleanup() {
+    "$ROOT_DIR/taskmasterctl" shutdown >/dev/null 2>&1 || true
+    if [ -n "$DAEMON_PID" ]; then
+        wait "$DAEMON_PID" 2>/dev/null || true
+    fi
+    for pid in ${PIDS:-}; do kill -9 "$pid" 2>/dev/null || true; done
+    rm -f "$CFG" "$STUBBORN" "$REPORT"
+}
+
+wait_for_daemon() {
+    local i
+    for i in $(seq 1 100); do
+        if "$ROOT_DIR/taskmasterctl" status >/dev/null 2>&1; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    return 1
+}
+
+cat > "$STUBBORN" <<'EOF_SH'
+#!/bin/sh
+trap '' TERM
+exec sleep 6012
+EOF_SH
+chmod +x "$STUBBORN"
+
+cat > "$CFG" <<EOF_CFG
+programs:
+  polite:
+    cmd: "/bin/sleep 6011"
+    numprocs: 3
+    stoptime: 5
+  stubborn:
+    cmd: "$STUBBORN"
+    numprocs: 2
+    stoptime: 2
+  stubborn_slow:
+    cmd: "$STUBBORN"
+    numprocs: 2
+    stoptime: 3
+EOF_CFG
+
+echo "Testing bounded parallel shutdown..."
+"$ROOT_DIR/taskmasterd" "$CFG" 2> "$LOG" &
+DAEMON_PID=$!
+wait_for_daemon || fail "daemon did not become ready"
+sleep 1.5
+[ "$("$ROOT_DIR/taskmasterctl" status | grep -c RUNNING)" -eq 7 ] || fail "instances did not start"
+PIDS=$("$ROOT_DIR/taskmasterctl" status | awk '/RUNNING/ { print $5 }')
+
+start=$(date +%s%N)
+"$ROOT_DIR/taskmasterctl" shutdown > "$REPORT" || fail "shutdown command failed"
+wait "$DAEMON_PID"
+DAEMON_PID=""
+elapsed_ms=$(( ($(date +%s%N) - start) / 1000000 ))
+
+# Stopping one instance after another would take 2*2 + 2*3 = 10 s
+[ "$elapsed_ms" -ge 2900 ] && [ "$elapsed_ms" -lt 4500 ] || fail "shutdown took $elapsed_ms ms, expected about 3 s"
+pass "shutdown bounded by the longest stoptime ($elapsed_ms ms)"
+
+for pid in $PIDS; do
+    kill -0 "$pid" 2>/dev/null && fail "child $pid survived the shutdown"
+done
+pass "every instance was stopped and reaped"
+
+grep -q "Process stubborn\[0\] did not stop within 2 s, sending SIGKILL" "$LOG" || fail "straggler was not escalated"
+grep -q "^stubborn_slow .* 2 stopped, .* 2 killed" "$REPORT" || fail "report lacks stubborn_slow latency"
+grep -q "^polite .* 3 stopped, .* 0 killed" "$REPORT" || fail "report lacks polite latency"
+grep -q "^Shutdown complete in" "$REPORT" || fail "shutdown reply is missing the report"
+pass "stragglers escalated to SIGKILL and per-program latency reported"
+
+# An instance dropped by a reload is still escalated at its stoptime, and
+# shutdown waits for it
+cat > "$CFG" <<EOF_CFG
+programs:
+  polite:
+    cmd: "/bin/sleep 6011"
+  dropped:
+    cmd: "$STUBBORN"
+    stoptime: 2
+EOF_CFG
+"$ROOT_DIR/taskmasterd" "$CFG" 2> "$LOG" &
+DAEMON_PID=$!
+wait_for_daemon || fail "daemon did not become ready"
+sleep 1.5
+PIDS=$("$ROOT_DIR/taskmasterctl" status | awk '/^dropped .*RUNNING/ { print $5 }')
+[ -n "$PIDS" ] || fail "dropped instance did not start"
+
+cat > "$CFG" <<EOF_CFG
+programs:
+  polite:
+    cmd: "/bin/sleep 6011"
+EOF_CFG
+"$ROOT_DIR/taskmasterctl" reload > /dev/null
+sleep 0.5
+start=$(date +%s%N)
+"$ROOT_DIR/taskmasterctl" shutdown > "$REPORT" || fail "shutdown command failed"
+wait "$DAEMON_PID"
+DAEMON_PID=""
+elapsed_ms=$(( ($(date +%s%N) - start) / 1000000 ))
+kill -0 "$PIDS" 2>/dev/null && fail "instance dropped by reload was orphaned"
+grep -q "Process dropped\[0\] did not stop within 2 s, sending SIGKILL" "$LOG" || fail "dropped instance was not escalated"
+[ "$elapsed_ms" -ge 1000 ] || fail "shutdown did not wait for the dropped instance ($elapsed_ms ms)"
+pass "instances dropped by a reload are escalated and awaited by shutdown"
+
+cleanup
+echo "Shutdown tests passed."
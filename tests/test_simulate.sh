@@ -0,0 +1,109 @@
+#!/bin/bash
+
+set -u
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+CFG="$ROOT_DIR/tests/tmp_simulate.yaml"
+LOG="$ROOT_DIR/error_output.txt"
+DAEMON_PID=""
+
+pass() {
+    echo -e "${GREEN}[PASS]${NC} $1"
+}
+
+fail() {
+    echo -e "${RED}[FAIL]${NC} $1"
+    [ -f "$LOG" ] && { echo "--- daemon log (tail) ---"; tail -n 40 "$LOG"; }
+    cleanup
+    exit 1
+}
+
+cleanup() {
+    "$ROOT_DIR/taskmasterctl" shutdown >/dev/null 2>&1 || true
+    if [ -n "$DAEMON_PID" ]; then
+        wait "$DAEMON_PID" 2>/dev/null || true
+    fi
+    rm -f "$CFG"
+}
+
+wait_for_daemon() {
+    local i
+    for i in $(seq 1 100); do
+        if "$ROOT_DIR/taskmasterctl" status >/dev/null 2>&1; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    return 1
+}
+
+stat_value() {
+    "$ROOT_DIR/taskmasterctl" stats | awk -v key="$1" '$1 == key { print $2 }'
+}
+
+cat > "$CFG" <<EOF_CFG
+programs:
+  worker:
+    cmd: "/bin/false"
+    numprocs: 1000
+    autostart: true
+    autorestart: always
+    startretries: 1000000
+    starttime: 0
+EOF_CFG
+
+echo "Testing the simulated process backend..."
+"$ROOT_DIR/taskmasterd" --simulate=exit_rate=0.1,seed=7 "$CFG" 2> "$LOG" &
+DAEMON_PID=$!
+wait_for_daemon || fail "daemon did not become ready"
+
+[ "$(stat_value backend)" = "sim" ] || fail "stats does not report the simulated backend"
+pass "daemon runs on the simulated backend"
+
+"$ROOT_DIR/taskmasterctl" status | grep -q "^worker .*RUNNING" || fail "simulated instances are not RUNNING"
+pass "1000 simulated instances started without forking"
+
+sleep 3
+reaped=$(stat_value reaped)
+[ "${reaped:-0}" -gt 50 ] || fail "expected random exits to be reaped, got ${reaped:-0}"
+grep -q "Restarting process worker" "$LOG" || fail "random exits were not restarted"
+pass "random exits are reaped and restarted ($reaped so far)"
+
+"$ROOT_DIR/taskmasterctl" stop all >/dev/null
+sleep 2
+running=$("$ROOT_DIR/taskmasterctl" status | grep -c "RUNNING\|STOPPING")
+[ "$running" -eq 0 ] || fail "$running instances still alive after stop all"
+pass "stop signals are delivered to simulated instances"
+
+"$ROOT_DIR/taskmasterctl" stats | grep -q "^scheduler .* calls" || fail "stats does not report scheduler timing"
+pass "stats reports operation timings"
+
+cleanup
+DAEMON_PID=""
+
+# Simulated exits do not raise SIGCHLD; the daemon must still wake for them
+cat > "$CFG" <<EOF_CFG
+programs:
+  quick:
+    cmd: "/bin/true"
+    numprocs: 5
+    autostart: true
+    starttime: 0
+EOF_CFG
+"$ROOT_DIR/taskmasterd" --simulate=stop_ms=20 "$CFG" 2> "$LOG" &
+DAEMON_PID=$!
+wait_for_daemon || fail "daemon did not become ready"
+sleep 0.5
+report="$("$ROOT_DIR/taskmasterctl" shutdown)"
+max_ms="$(echo "$report" | awk '$1 == "quick" { print $(NF - 3) }')"
+[ -n "$max_ms" ] && [ "$max_ms" -lt 500 ] || fail "simulated stops waited for the loop tick: $report"
+pass "simulated exits are reaped when due (max $max_ms ms)"
+wait "$DAEMON_PID" 2>/dev/null
+DAEMON_PID=""
+
+cleanup
+echo "Simulated backend tests passed."
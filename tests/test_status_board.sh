@@ -0,0 +1,115 @@
+#!/bin/bash
+
+set -u
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+CFG="$ROOT_DIR/tests/tmp_status_board.yaml"
+LOG="$ROOT_DIR/error_output.txt"
+DAEMON_PID=""
+
+pass() {
+    echo -e "${GREEN}[PASS]${NC} $1"
+}
+
+fail() {
+    echo -e "${RED}[FAIL]${NC} $1"
+    [ -f "$LOG" ] && { echo "--- daemon log (tail) ---"; tail -n 40 "$LOG"; }
+    cleanup
+    exit 1
+}
+
+cleanup() {
+    "$ROOT_DIR/taskmasterctl" shutdown >/dev/null 2>&1 || true
+    if [ -n "$DAEMON_PID" ]; then
+        wait "$DAEMON_PID" 2>/dev/null || true
+    fi
+    rm -f "$CFG"
+}
+
+wait_for_daemon() {
+    local i
+    for i in $(seq 1 100); do
+        if "$ROOT_DIR/taskmasterctl" status >/dev/null 2>&1; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    return 1
+}
+
+status_calls() {
+    "$ROOT_DIR/taskmasterctl" stats | awk '$1 == "status" { print $2 }'
+}
+
+write_config() {
+    cat > "$CFG" <<EOF_CFG
+programs:
+  worker:
+    cmd: "/bin/false"
+    numprocs: $1
+    autorestart: always
+    startretries: 1000000
+    starttime: 0
+EOF_CFG
+}
+
+write_config 2000
+echo "Testing the shared-memory status board..."
+"$ROOT_DIR/taskmasterd" --simulate=exit_rate=0.2,seed=3 "$CFG" 2> "$LOG" &
+DAEMON_PID=$!
+wait_for_daemon || fail "daemon did not become ready"
+
+"$ROOT_DIR/taskmasterctl" status --fast | grep -q "^worker .*RUNNING .*pid 1[0-9]* restarts" || fail "status --fast shows no instances"
+pass "status --fast reads the board"
+
+before=$(status_calls)
+for i in $(seq 1 50); do
+    lines=$("$ROOT_DIR/taskmasterctl" status --fast | grep -c "^worker ")
+    [ "$lines" -eq 2000 ] || fail "snapshot $i has $lines entries instead of 2000"
+done
+after=$(status_calls)
+[ "$before" = "$after" ] || fail "status --fast sent requests to the daemon ($before -> $after)"
+pass "50 consistent snapshots under churn without daemon requests"
+
+"$ROOT_DIR/taskmasterctl" -j status --fast | grep -q '^{"command":"status --fast","success":true,"processes":\[{"name":"worker"' \
+    || fail "JSON board output is malformed"
+pass "JSON output"
+
+write_config 3000
+"$ROOT_DIR/taskmasterctl" reload >/dev/null
+for i in $(seq 1 100); do
+    lines=$("$ROOT_DIR/taskmasterctl" status --fast | grep -c "^worker ")
+    [ "$lines" -eq 3000 ] && break
+    sleep 0.2
+done
+[ "$lines" -eq 3000 ] || fail "board did not grow after reload ($lines entries)"
+pass "board grows with the process table"
+
+# A daemon restarted after a crash must not shrink the board a reader still
+# holds; it publishes a new segment instead
+BOARD=/dev/shm/taskmaster.status
+exec 3< "$BOARD"
+old_size=$(stat -L -c %s /proc/self/fd/3)
+kill -9 "$DAEMON_PID"
+wait "$DAEMON_PID" 2>/dev/null
+write_config 10
+"$ROOT_DIR/taskmasterd" --simulate "$CFG" 2> "$LOG" &
+DAEMON_PID=$!
+wait_for_daemon || fail "daemon did not restart"
+held_size=$(stat -L -c %s /proc/self/fd/3)
+[ "$(stat -L -c %i /proc/self/fd/3)" != "$(stat -c %i "$BOARD")" ] && [ "$held_size" -eq "$old_size" ] \
+    || fail "restart resized the board a reader still holds ($old_size -> $held_size bytes)"
+exec 3<&-
+"$ROOT_DIR/taskmasterctl" status --fast | grep -c "^worker " | grep -qx 10 || fail "restarted daemon board is wrong"
+pass "restart publishes a fresh board and leaves the old one intact"
+
+cleanup
+DAEMON_PID=""
+"$ROOT_DIR/taskmasterctl" status --fast >/dev/null 2>&1 && fail "board still readable after shutdown"
+pass "board is removed on shutdown"
+
+echo "Status board tests passed."